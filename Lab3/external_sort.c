@@ -0,0 +1,778 @@
+/*
+ * FILE: external_sort.c
+ *     External merge sort.  The input is cut into runs of a third of the
+ *     memory budget each: while one run is sorted with the radix sort and
+ *     appended to a temporary file, a thread reads the next one into the
+ *     second third, and the last third is the buffer of the radix sort.
+ *     The runs are then merged with a loser tree, each read through a
+ *     buffer of its own, while another thread turns the merged numbers
+ *     into text and writes them out.  All the runs go in one temporary
+ *     file, one after another, so no more than two files are ever open.
+ */
+
+/* Needed for pthreads under -ansi. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "array_sort.h"
+#include "int_io.h"
+#include "external_sort.h"
+
+
+/*
+ * Two blocks of numbers handed from one thread to another.  The producer
+ * fills block 0, then block 1, then block 0 again, and so on, and the
+ * consumer empties them in the same order, so each thread works on one
+ * block while the other thread works on the other.
+ */
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int *blocks[2];
+    long counts[2];
+    int full[2];                /* set while the consumer has the block */
+    int finished;               /* set when the producer is done */
+    int failed;                 /* set when the consumer gives up */
+} block_pipe;
+
+/* A sorted run of 'length' numbers in a temporary file, from 'start'. */
+typedef struct
+{
+    long start;
+    long length;
+} sort_run;
+
+/* A run being merged, read into its buffer a part at a time. */
+typedef struct
+{
+    long next;                  /* the next number to read from the file */
+    long left;                  /* numbers of the run not yet read */
+    int *buffer;
+    long size;                  /* numbers 'buffer' has room for */
+    long pos;                   /* the next number of 'buffer' */
+    long count;                 /* numbers in 'buffer' */
+    int key;                    /* buffer[pos], if 'done' is not set */
+    int done;                   /* set once the run is used up */
+} merge_input;
+
+/* The thread that reads the input a block at a time. */
+typedef struct
+{
+    block_pipe pipe;
+    int_reader reader;
+    long block_size;
+    int bad_input;
+    pthread_t thread;
+} input_thread;
+
+/* The thread that writes the merged numbers. */
+typedef struct
+{
+    block_pipe pipe;
+    int_writer writer;
+    int failed;
+    pthread_t thread;
+} output_thread;
+
+
+void *allocate(size_t size);
+void out_of_memory(void);
+void start_thread(pthread_t *thread, void *(*start)(void *), void *arg);
+void init_block_pipe(block_pipe *p, int *first, int *second);
+void destroy_block_pipe(block_pipe *p);
+int *empty_block(block_pipe *p, int i);
+void put_block(block_pipe *p, int i, long n);
+void finish_blocks(block_pipe *p);
+int *full_block(block_pipe *p, int i, long *n);
+int last_block(block_pipe *p, int i);
+void release_block(block_pipe *p, int i);
+void fail_blocks(block_pipe *p);
+void *input_main(void *arg);
+void *output_main(void *arg);
+int make_runs(FILE *in, FILE *out, int binary, long memory, FILE **spill,
+              sort_run **runs, long *nruns);
+int merge_runs(FILE *spill, sort_run *runs, int k, FILE *out, int binary,
+               long memory);
+int refill_input(FILE *spill, merge_input *input);
+int beats(merge_input *inputs, int x, int y);
+
+
+/*
+ * external_sort:
+ *     Sort the input into runs, then merge them.  Each run being merged
+ *     needs a buffer of MIN_MERGE_BUFFER bytes, which limits how many
+ *     can be merged at once; if there are more, groups of them are merged
+ *     into longer runs in a second temporary file, and so on until one
+ *     merge is enough.
+ */
+
+int
+external_sort(FILE *in, FILE *out, int binary, long memory)
+{
+    FILE *spill;
+    FILE *next;
+    sort_run *runs;
+    long nruns;
+    long ways;
+    long written;
+    long length;
+    long r, m, j;
+    int k;
+    int result;
+
+    if (memory < MIN_EXTERNAL_MEMORY)
+    {
+        memory = MIN_EXTERNAL_MEMORY;
+    }
+
+    result = make_runs(in, out, binary, memory, &spill, &runs, &nruns);
+
+    /* 'merge_runs' gives three quarters of the memory to the runs. */
+    ways = memory / 4 * 3 / MIN_MERGE_BUFFER;
+
+    while (result == EXTERNAL_SORT_OK && nruns > ways)
+    {
+        next = tmpfile();
+        if (next == NULL)
+        {
+            result = EXTERNAL_SORT_TEMP_ERROR;
+            break;
+        }
+
+        /* The merged runs take the place of the first runs in 'runs'. */
+        written = 0;
+        for (r = 0, m = 0; r < nruns && result == EXTERNAL_SORT_OK;
+             r += k, m++)
+        {
+            k = (int)((nruns - r < ways) ? nruns - r : ways);
+            length = 0;
+            for (j = r; j < r + k; j++)
+            {
+                length += runs[j].length;
+            }
+
+            result = merge_runs(spill, runs + r, k, next, 1, memory);
+            runs[m].start = written;
+            runs[m].length = length;
+            written += length;
+        }
+        if (result == EXTERNAL_SORT_WRITE_ERROR)
+        {
+            result = EXTERNAL_SORT_TEMP_ERROR;
+        }
+
+        fclose(spill);
+        spill = next;
+        nruns = m;
+    }
+
+    if (result == EXTERNAL_SORT_OK && spill != NULL)
+    {
+        result = merge_runs(spill, runs, (int)nruns, out, binary, memory);
+    }
+
+    if (spill != NULL)
+    {
+        fclose(spill);
+    }
+    if (runs != NULL)
+    {
+        free(runs);
+    }
+    return result;
+}
+
+
+/*
+ * make_runs:
+ *     Read the input in blocks, sort each block and append it to the
+ *     temporary file '*spill' as a run, listed in '*runs'.  If all the
+ *     numbers fit in one block, they are written straight to 'out', and
+ *     '*spill' is left NULL.
+ */
+
+int
+make_runs(FILE *in, FILE *out, int binary, long memory, FILE **spill,
+          sort_run **runs, long *nruns)
+{
+    input_thread input;
+    sort_run *grown;
+    long block_size = memory / (3 * sizeof(int));
+    long capacity = 0;
+    long written = 0;
+    int result = EXTERNAL_SORT_OK;
+    int *memory_start;
+    int *buffer;
+    int *block;
+    long n;
+    int i;
+
+    *spill = NULL;
+    *runs = NULL;
+    *nruns = 0;
+
+    memory_start = (int *)allocate(3 * block_size * sizeof(int));
+    buffer = memory_start + 2 * block_size;
+
+    init_block_pipe(&input.pipe, memory_start, memory_start + block_size);
+    init_int_reader(&input.reader, in, binary);
+    input.block_size = block_size;
+    input.bad_input = 0;
+    start_thread(&input.thread, input_main, &input);
+
+    for (i = 0; (block = full_block(&input.pipe, i, &n)) != NULL; i ^= 1)
+    {
+        if (n < RADIX_SORT_THRESHOLD)
+        {
+            introsort(block, n);
+        }
+        else
+        {
+            radix_sort_with_buffer(block, buffer, n);
+        }
+
+        /*
+         * The first block is the only one if the input ends with it.
+         * 'bad_input' is set before the input thread finishes, so it
+         * can be read once 'last_block' has seen it finish.
+         */
+        if (*nruns == 0 && last_block(&input.pipe, i ^ 1))
+        {
+            if (input.bad_input)
+            {
+                break;
+            }
+            if (out != NULL && write_ints(out, block, n, binary) != 0)
+            {
+                result = EXTERNAL_SORT_WRITE_ERROR;
+                fail_blocks(&input.pipe);
+                break;
+            }
+        }
+        else
+        {
+            if (*spill == NULL)
+            {
+                *spill = tmpfile();
+            }
+            if (*spill == NULL
+                || fwrite(block, sizeof(int), n, *spill) != (size_t)n)
+            {
+                result = EXTERNAL_SORT_TEMP_ERROR;
+                fail_blocks(&input.pipe);
+                break;
+            }
+
+            if (*nruns == capacity)
+            {
+                capacity = (capacity > 0) ? capacity * 2 : 16;
+                grown = (sort_run *)realloc(*runs,
+                                            capacity * sizeof(sort_run));
+                if (grown == NULL)
+                {
+                    out_of_memory();
+                }
+                *runs = grown;
+            }
+            (*runs)[*nruns].start = written;
+            (*runs)[*nruns].length = n;
+            (*nruns)++;
+            written += n;
+        }
+
+        release_block(&input.pipe, i);
+    }
+
+    pthread_join(input.thread, NULL);
+    destroy_block_pipe(&input.pipe);
+    free(memory_start);
+
+    if (input.bad_input)
+    {
+        return EXTERNAL_SORT_BAD_INPUT;
+    }
+    if (result == EXTERNAL_SORT_OK && *spill != NULL && fflush(*spill) != 0)
+    {
+        result = EXTERNAL_SORT_TEMP_ERROR;
+    }
+    return result;
+}
+
+
+/*
+ * input_main:
+ *     The input thread.  Read blocks of numbers until the input ends, or
+ *     until it turns out not to be numbers, or the sort gives up.
+ */
+
+void *
+input_main(void *arg)
+{
+    input_thread *input = (input_thread *)arg;
+    int *block;
+    long n;
+    int i;
+
+    for (i = 0; (block = empty_block(&input->pipe, i)) != NULL; i ^= 1)
+    {
+        n = read_some_ints(&input->reader, block, input->block_size);
+        if (n <= 0)
+        {
+            input->bad_input = (n < 0);
+            break;
+        }
+        put_block(&input->pipe, i, n);
+    }
+
+    finish_blocks(&input->pipe);
+    return NULL;
+}
+
+
+/*
+ * merge_runs:
+ *     Merge 'k' runs of 'spill' into 'out'.  The two output blocks get a
+ *     quarter of the memory and the buffers of the runs share the rest.
+ *
+ *     The loser tree has the runs as its leaves: leaf 'r' is node r + k,
+ *     the parent of node 'x' is x / 2, and each inner node holds the run
+ *     that lost the match played there.  Once the smallest number, the
+ *     winner, has been taken, its run plays the matches on the path from
+ *     its leaf to the root again, which takes log2 k comparisons, against
+ *     the losers stored on the path; the winner of each match goes up.
+ *     Node 0 is not used, as the overall winner is kept in 'winner'.
+ */
+
+int
+merge_runs(FILE *spill, sort_run *runs, int k, FILE *out, int binary,
+           long memory)
+{
+    output_thread output;
+    merge_input *inputs;
+    int *tree;
+    int *memory_start;
+    int *block;
+    long block_size = memory / (8 * sizeof(int));
+    long buffer_size;
+    long n;
+    int result = EXTERNAL_SORT_OK;
+    int winner;
+    int player;
+    int node;
+    int t;
+    int r;
+    int i;
+
+    buffer_size = (memory - 2 * block_size * (long)sizeof(int))
+                  / (k * (long)sizeof(int));
+    memory_start = (int *)allocate((2 * block_size + k * buffer_size)
+                                   * sizeof(int));
+    inputs = (merge_input *)allocate(k * sizeof(merge_input));
+    tree = (int *)allocate(k * sizeof(int));
+
+    for (r = 0; r < k; r++)
+    {
+        inputs[r].next = runs[r].start;
+        inputs[r].left = runs[r].length;
+        inputs[r].buffer = memory_start + 2 * block_size + r * buffer_size;
+        inputs[r].size = buffer_size;
+        inputs[r].done = 0;
+        if (refill_input(spill, &inputs[r]) != 0)
+        {
+            result = EXTERNAL_SORT_TEMP_ERROR;
+        }
+    }
+
+    /*
+     * Build the tree by sending each run up from its leaf.  A run that
+     * reaches an empty node waits there for the winner of the other side
+     * of the node; the one that reaches the root has won every match.
+     */
+    for (node = 0; node < k; node++)
+    {
+        tree[node] = -1;
+    }
+    winner = 0;
+    for (r = 0; r < k; r++)
+    {
+        player = r;
+        for (node = (r + k) / 2; node > 0 && player >= 0; node /= 2)
+        {
+            if (tree[node] < 0)
+            {
+                tree[node] = player;
+                player = -1;
+            }
+            else if (beats(inputs, tree[node], player))
+            {
+                t = tree[node]; tree[node] = player; player = t;
+            }
+        }
+        if (player >= 0)
+        {
+            winner = player;
+        }
+    }
+
+    init_block_pipe(&output.pipe, memory_start, memory_start + block_size);
+    init_int_writer(&output.writer, out, binary);
+    output.failed = 0;
+    start_thread(&output.thread, output_main, &output);
+
+    for (i = 0; result == EXTERNAL_SORT_OK && !inputs[winner].done; i ^= 1)
+    {
+        block = empty_block(&output.pipe, i);
+        if (block == NULL)
+        {
+            break;
+        }
+
+        for (n = 0; n < block_size && !inputs[winner].done; n++)
+        {
+            block[n] = inputs[winner].key;
+
+            if (++inputs[winner].pos < inputs[winner].count)
+            {
+                inputs[winner].key = inputs[winner].buffer[inputs[winner].pos];
+            }
+            else if (refill_input(spill, &inputs[winner]) != 0)
+            {
+                result = EXTERNAL_SORT_TEMP_ERROR;
+            }
+
+            for (node = (winner + k) / 2; node > 0; node /= 2)
+            {
+                if (beats(inputs, tree[node], winner))
+                {
+                    t = tree[node]; tree[node] = winner; winner = t;
+                }
+            }
+        }
+
+        put_block(&output.pipe, i, n);
+    }
+
+    finish_blocks(&output.pipe);
+    pthread_join(output.thread, NULL);
+    destroy_block_pipe(&output.pipe);
+
+    if (result == EXTERNAL_SORT_OK && output.failed)
+    {
+        result = EXTERNAL_SORT_WRITE_ERROR;
+    }
+
+    free(memory_start);
+    free(inputs);
+    free(tree);
+    return result;
+}
+
+
+/*
+ * output_main:
+ *     The output thread.  Write blocks of numbers until the merge is
+ *     done, then flush; if a write fails, make the merge give up.  With
+ *     no file to write to, the blocks are just let go.
+ */
+
+void *
+output_main(void *arg)
+{
+    output_thread *output = (output_thread *)arg;
+    int *block;
+    long n;
+    int i;
+
+    for (i = 0; (block = full_block(&output->pipe, i, &n)) != NULL; i ^= 1)
+    {
+        if (output->writer.fp != NULL
+            && write_some_ints(&output->writer, block, n) != 0)
+        {
+            output->failed = 1;
+            fail_blocks(&output->pipe);
+            return NULL;
+        }
+        release_block(&output->pipe, i);
+    }
+
+    if (output->writer.fp != NULL && flush_int_writer(&output->writer) != 0)
+    {
+        output->failed = 1;
+    }
+    return NULL;
+}
+
+
+/*
+ * refill_input:
+ *     Read the next part of a run into its buffer, or mark the run done
+ *     if it has none.  The runs share the file, so each read seeks to
+ *     where its run goes on.  Return -1 on a read error.
+ */
+
+int
+refill_input(FILE *spill, merge_input *input)
+{
+    long n = (input->left < input->size) ? input->left : input->size;
+
+    input->pos = 0;
+    input->count = n;
+    if (n == 0)
+    {
+        input->done = 1;
+        return 0;
+    }
+
+    if (fseek(spill, input->next * (long)sizeof(int), SEEK_SET) != 0
+        || fread(input->buffer, sizeof(int), n, spill) != (size_t)n)
+    {
+        input->done = 1;
+        return -1;
+    }
+
+    input->next += n;
+    input->left -= n;
+    input->key = input->buffer[0];
+    return 0;
+}
+
+
+/*
+ * beats:
+ *     Return 1 if run 'x' has a smaller next number than run 'y'.  A run
+ *     that is done loses to every other.
+ */
+
+int
+beats(merge_input *inputs, int x, int y)
+{
+    if (inputs[x].done)
+    {
+        return 0;
+    }
+    if (inputs[y].done)
+    {
+        return 1;
+    }
+    return inputs[x].key < inputs[y].key;
+}
+
+
+/*
+ * init_block_pipe:
+ *     Make a pipe of two empty blocks.
+ */
+
+void
+init_block_pipe(block_pipe *p, int *first, int *second)
+{
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->changed, NULL);
+    p->blocks[0] = first;
+    p->blocks[1] = second;
+    p->counts[0] = p->counts[1] = 0;
+    p->full[0] = p->full[1] = 0;
+    p->finished = 0;
+    p->failed = 0;
+}
+
+
+/*
+ * destroy_block_pipe:
+ *     Free the lock of a pipe.  The blocks belong to the caller.
+ */
+
+void
+destroy_block_pipe(block_pipe *p)
+{
+    pthread_cond_destroy(&p->changed);
+    pthread_mutex_destroy(&p->lock);
+}
+
+
+/*
+ * empty_block:
+ *     Wait until the consumer has emptied block 'i', and return it, or
+ *     NULL if the consumer has given up.
+ */
+
+int *
+empty_block(block_pipe *p, int i)
+{
+    int *block;
+
+    pthread_mutex_lock(&p->lock);
+    while (p->full[i] && !p->failed)
+    {
+        pthread_cond_wait(&p->changed, &p->lock);
+    }
+    block = p->failed ? NULL : p->blocks[i];
+    pthread_mutex_unlock(&p->lock);
+
+    return block;
+}
+
+
+/*
+ * put_block:
+ *     Hand block 'i', holding 'n' numbers, to the consumer.
+ */
+
+void
+put_block(block_pipe *p, int i, long n)
+{
+    pthread_mutex_lock(&p->lock);
+    p->counts[i] = n;
+    p->full[i] = 1;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+
+/*
+ * finish_blocks:
+ *     Tell the consumer that no more blocks will come.
+ */
+
+void
+finish_blocks(block_pipe *p)
+{
+    pthread_mutex_lock(&p->lock);
+    p->finished = 1;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+
+/*
+ * full_block:
+ *     Wait until the producer has filled block 'i', and return it with
+ *     its count in '*n', or NULL if no more blocks will come.
+ */
+
+int *
+full_block(block_pipe *p, int i, long *n)
+{
+    int *block = NULL;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->full[i] && !p->finished)
+    {
+        pthread_cond_wait(&p->changed, &p->lock);
+    }
+    if (p->full[i])
+    {
+        block = p->blocks[i];
+        *n = p->counts[i];
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return block;
+}
+
+
+/*
+ * last_block:
+ *     Wait until block 'i', the one after the block the consumer has,
+ *     is filled or will never be, and return 1 if it never will.
+ */
+
+int
+last_block(block_pipe *p, int i)
+{
+    int last;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->full[i] && !p->finished)
+    {
+        pthread_cond_wait(&p->changed, &p->lock);
+    }
+    last = !p->full[i];
+    pthread_mutex_unlock(&p->lock);
+
+    return last;
+}
+
+
+/*
+ * release_block:
+ *     Give block 'i' back to the producer, emptied.
+ */
+
+void
+release_block(block_pipe *p, int i)
+{
+    pthread_mutex_lock(&p->lock);
+    p->full[i] = 0;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+
+/*
+ * fail_blocks:
+ *     Tell the producer that the consumer has given up.
+ */
+
+void
+fail_blocks(block_pipe *p)
+{
+    pthread_mutex_lock(&p->lock);
+    p->failed = 1;
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+
+/*
+ * allocate:
+ *     Allocate memory, or exit if there is none.
+ */
+
+void *
+allocate(size_t size)
+{
+    void *p = malloc(size);
+
+    if (p == NULL)
+    {
+        out_of_memory();
+    }
+    return p;
+}
+
+
+/*
+ * out_of_memory:
+ *     Exit with the message of 'reserve_ints'.
+ */
+
+void
+out_of_memory(void)
+{
+    fprintf(stderr, "Fatal error: out of memory. "
+            "Terminating program.\n");
+    exit(1);
+}
+
+
+/*
+ * start_thread:
+ *     Start a thread, or exit if one cannot be had.  The sort cannot go
+ *     on without it, as each side of a pipe waits for the other.
+ */
+
+void
+start_thread(pthread_t *thread, void *(*start)(void *), void *arg)
+{
+    if (pthread_create(thread, NULL, start, arg) != 0)
+    {
+        fprintf(stderr, "Fatal error: cannot start a thread. "
+                "Terminating program.\n");
+        exit(1);
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * FILE: external_sort.h
+ */
+
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <stdio.h>
+
+
+/*
+ * Sorting numbers that need not fit in memory.  The input is read in
+ * runs as large as a memory budget allows; each run is sorted and
+ * written to a temporary file, and the runs are then merged into the
+ * output.  A thread reads the next run while the last one is sorted and
+ * written, and another writes the output while the runs are merged.
+ */
+
+/* The default memory budget, in megabytes. */
+#define EXTERNAL_SORT_MEMORY 256
+
+/* Smaller budgets, in bytes, are raised to this. */
+#define MIN_EXTERNAL_MEMORY (1L << 20)
+
+/*
+ * Every run being merged gets a buffer of at least this many bytes, so
+ * that it is read in long sequential reads.  If that makes too many runs
+ * to merge at once, they are merged in several passes.
+ */
+#define MIN_MERGE_BUFFER (64L << 10)
+
+/* What 'external_sort' returns. */
+#define EXTERNAL_SORT_OK 0
+#define EXTERNAL_SORT_BAD_INPUT (-1)    /* the input is not all numbers */
+#define EXTERNAL_SORT_WRITE_ERROR (-2)  /* the output cannot be written */
+#define EXTERNAL_SORT_TEMP_ERROR (-3)   /* nor can the temporary files */
+
+
+/*
+ * Read all the numbers from 'in', as text or binary like 'read_ints',
+ * and write them sorted to 'out' like 'write_ints', using about 'memory'
+ * bytes.  If 'out' is NULL, the numbers are sorted but not written.
+ * Returns one of the results above.
+ */
+int external_sort(FILE *in, FILE *out, int binary, long memory);
+
+#endif  /* EXTERNAL_SORT_H */
@@ -0,0 +1,437 @@
+/*
+ * FILE: int_io.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "int_io.h"
+
+/* Input is read into an int_array this many numbers at a time. */
+#define READ_CHUNK (IO_BUFFER_SIZE / 4)
+
+/* The longest number in text, "-2147483648\n". */
+#define MAX_NUMBER_TEXT 12
+
+
+long read_some_text_ints(int_reader *r, int *a, long max);
+long read_some_binary_ints(int_reader *r, int *a, long max);
+
+
+/*
+ * init_int_array:
+ *     Make an int_array empty.  Nothing is allocated until a number is
+ *     added.
+ */
+
+void
+init_int_array(int_array *a)
+{
+    a->data = NULL;
+    a->length = 0;
+    a->capacity = 0;
+}
+
+
+/*
+ * free_int_array:
+ *     Free the numbers of an int_array and make it empty.
+ */
+
+void
+free_int_array(int_array *a)
+{
+    if (a->data != NULL)
+    {
+        free(a->data);
+    }
+    init_int_array(a);
+}
+
+
+/*
+ * reserve_ints:
+ *     Make room for at least 'capacity' numbers.  The room at least
+ *     doubles every time it grows, so adding N numbers one at a time
+ *     copies O(N) numbers in all.
+ */
+
+void
+reserve_ints(int_array *a, long capacity)
+{
+    long new_capacity;
+    int *data;
+
+    if (capacity <= a->capacity)
+    {
+        return;
+    }
+
+    new_capacity = (a->capacity > 0) ? a->capacity * 2 : INT_ARRAY_START;
+    if (new_capacity < capacity)
+    {
+        new_capacity = capacity;
+    }
+
+    data = (int *)realloc(a->data, new_capacity * sizeof(int));
+    if (data == NULL)
+    {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    a->data = data;
+    a->capacity = new_capacity;
+}
+
+
+/*
+ * add_int:
+ *     Add a number to the end of an int_array.
+ */
+
+void
+add_int(int_array *a, int value)
+{
+    if (a->length == a->capacity)
+    {
+        reserve_ints(a, a->length + 1);
+    }
+    a->data[a->length++] = value;
+}
+
+
+/*
+ * read_ints:
+ *     Read all the numbers from 'fp' as text or binary, straight into the
+ *     room at the end of the array.
+ */
+
+int
+read_ints(FILE *fp, int binary, int_array *a)
+{
+    int_reader reader;
+    long got;
+
+    init_int_reader(&reader, fp, binary);
+    do
+    {
+        reserve_ints(a, a->length + READ_CHUNK);
+        got = read_some_ints(&reader, a->data + a->length,
+                             a->capacity - a->length);
+        if (got < 0)
+        {
+            return -1;
+        }
+        a->length += got;
+    } while (got > 0);
+
+    return 0;
+}
+
+
+/*
+ * init_int_reader:
+ *     Start reading from 'fp' with an empty buffer.
+ */
+
+void
+init_int_reader(int_reader *r, FILE *fp, int binary)
+{
+    r->fp = fp;
+    r->binary = binary;
+    r->pos = 0;
+    r->end = 0;
+    r->at_end = 0;
+    r->in_number = 0;
+    r->negative = 0;
+    r->digits = 0;
+    r->value = 0;
+}
+
+
+/*
+ * read_some_ints:
+ *     Read up to 'max' numbers as text or binary.
+ */
+
+long
+read_some_ints(int_reader *r, int *a, long max)
+{
+    if (r->binary)
+    {
+        return read_some_binary_ints(r, a, max);
+    }
+    return read_some_text_ints(r, a, max);
+}
+
+
+/*
+ * read_some_text_ints:
+ *     Read numbers in text, a block at a time.  A number may be split
+ *     between two blocks, or between two calls, so the number being read
+ *     is kept in the reader: 'in_number' is set while in a number,
+ *     'digits' counts its digits so far, and 'value' is their value
+ *     without the sign.  They are copied to locals while a block is
+ *     read, which keeps them in registers.
+ */
+
+long
+read_some_text_ints(int_reader *r, int *a, long max)
+{
+    unsigned long value = r->value;
+    unsigned long limit;
+    int negative = r->negative;
+    int in_number = r->in_number;
+    int digits = r->digits;
+    long n = 0;
+    size_t i;
+    char c;
+
+    while (n < max)
+    {
+        if (r->pos == r->end)
+        {
+            if (r->at_end)
+            {
+                break;
+            }
+            r->pos = 0;
+            r->end = fread(r->buffer, 1, sizeof(r->buffer), r->fp);
+            if (r->end == 0)
+            {
+                r->at_end = 1;
+                if (ferror(r->fp) || (in_number && digits == 0))
+                {
+                    return -1;
+                }
+
+                /* The end of the input ends the last number. */
+                if (in_number)
+                {
+                    a[n++] = negative ? (int)(-(long)(value - 1) - 1)
+                                      : (int)value;
+                    in_number = 0;
+                }
+                break;
+            }
+        }
+
+        for (i = r->pos; i < r->end && n < max; i++)
+        {
+            c = r->buffer[i];
+
+            if (c >= '0' && c <= '9')
+            {
+                if (!in_number)
+                {
+                    in_number = 1;
+                    negative = 0;
+                    value = 0;
+                    digits = 0;
+                }
+
+                /* INT_MIN has one more than INT_MAX without its sign. */
+                value = value * 10 + (c - '0');
+                digits++;
+                limit = negative ? (unsigned long)INT_MAX + 1
+                                 : (unsigned long)INT_MAX;
+                if (value > limit)
+                {
+                    return -1;
+                }
+            }
+            else if (c == '-' || c == '+')
+            {
+                if (in_number)
+                {
+                    return -1;
+                }
+                in_number = 1;
+                negative = (c == '-');
+                value = 0;
+                digits = 0;
+            }
+            else if (c == ' ' || c == '\n' || c == '\t' || c == '\r'
+                     || c == '\f' || c == '\v')
+            {
+                if (in_number)
+                {
+                    if (digits == 0)
+                    {
+                        return -1;
+                    }
+                    a[n++] = negative ? (int)(-(long)(value - 1) - 1)
+                                      : (int)value;
+                    in_number = 0;
+                }
+            }
+            else
+            {
+                return -1;
+            }
+        }
+        r->pos = i;
+    }
+
+    r->value = value;
+    r->negative = negative;
+    r->in_number = in_number;
+    r->digits = digits;
+    return n;
+}
+
+
+/*
+ * read_some_binary_ints:
+ *     Read 4-byte numbers straight into 'a'.  A read may end in the
+ *     middle of a number; its first bytes are then kept in the buffer of
+ *     the reader, and put in front of the next read.
+ */
+
+long
+read_some_binary_ints(int_reader *r, int *a, long max)
+{
+    size_t want;
+    size_t got;
+    size_t bytes;
+    long n;
+
+    if (r->at_end)
+    {
+        return 0;
+    }
+
+    memcpy(a, r->buffer, r->end);
+    want = max * sizeof(int) - r->end;
+    got = fread((char *)a + r->end, 1, want, r->fp);
+
+    bytes = r->end + got;
+    n = (long)(bytes / sizeof(int));
+    r->end = bytes % sizeof(int);
+    memcpy(r->buffer, a + n, r->end);
+
+    if (got < want)
+    {
+        r->at_end = 1;
+        if (ferror(r->fp) || r->end != 0)
+        {
+            return -1;
+        }
+    }
+    return n;
+}
+
+
+/*
+ * write_ints:
+ *     Write 'n' numbers to 'fp' through a writer, and flush it.
+ */
+
+int
+write_ints(FILE *fp, int *a, long n, int binary)
+{
+    int_writer writer;
+
+    init_int_writer(&writer, fp, binary);
+    if (write_some_ints(&writer, a, n) != 0)
+    {
+        return -1;
+    }
+    return flush_int_writer(&writer);
+}
+
+
+/*
+ * init_int_writer:
+ *     Start writing to 'fp' with an empty buffer.
+ */
+
+void
+init_int_writer(int_writer *w, FILE *fp, int binary)
+{
+    w->fp = fp;
+    w->binary = binary;
+    w->used = 0;
+}
+
+
+/*
+ * write_some_ints:
+ *     Write 'n' numbers.  Binary numbers are handed straight to 'fwrite'.
+ *     Text is made in the buffer, writing the digits of each number
+ *     backwards from its end, and the buffer is written out whenever it
+ *     might not hold another number.
+ */
+
+int
+write_some_ints(int_writer *w, int *a, long n)
+{
+    char digits[MAX_NUMBER_TEXT];
+    unsigned long value;
+    size_t used = w->used;
+    long i;
+    int k;
+
+    if (w->binary)
+    {
+        if (n > 0 && fwrite(a, sizeof(int), n, w->fp) != (size_t)n)
+        {
+            return -1;
+        }
+        return 0;
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        if (used > sizeof(w->buffer) - MAX_NUMBER_TEXT)
+        {
+            if (fwrite(w->buffer, 1, used, w->fp) != used)
+            {
+                return -1;
+            }
+            used = 0;
+        }
+
+        /* Working without the sign also works for INT_MIN. */
+        value = (a[i] < 0) ? 0UL - (unsigned long)a[i]
+                           : (unsigned long)a[i];
+
+        k = MAX_NUMBER_TEXT;
+        digits[--k] = '\n';
+        do
+        {
+            digits[--k] = (char)('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+        if (a[i] < 0)
+        {
+            digits[--k] = '-';
+        }
+
+        memcpy(w->buffer + used, digits + k, MAX_NUMBER_TEXT - k);
+        used += MAX_NUMBER_TEXT - k;
+    }
+
+    w->used = used;
+    return 0;
+}
+
+
+/*
+ * flush_int_writer:
+ *     Write out what is left in the buffer, then flush the file.
+ */
+
+int
+flush_int_writer(int_writer *w)
+{
+    if (w->used > 0 && fwrite(w->buffer, 1, w->used, w->fp) != w->used)
+    {
+        return -1;
+    }
+    w->used = 0;
+    return fflush(w->fp) == 0 ? 0 : -1;
+}
@@ -0,0 +1,119 @@
+/*
+ * FILE: int_io.h
+ */
+
+#ifndef INT_IO_H
+#define INT_IO_H
+
+#include <stdio.h>
+
+
+/*
+ * Reading and writing many numbers at once.  Text is read and written
+ * in blocks of IO_BUFFER_SIZE bytes and converted by hand, which is much
+ * faster than calling 'atoi' or 'printf' once per number.  Binary input
+ * and output are 4-byte ints in the byte order of the machine, copied
+ * straight to and from memory.
+ */
+
+#define IO_BUFFER_SIZE 65536
+
+/* The first allocation of an int_array holds this many numbers. */
+#define INT_ARRAY_START 1024
+
+
+/*
+ * An array of numbers that grows as numbers are added.  Only the
+ * functions below should allocate or free 'data'.
+ */
+
+typedef struct
+{
+  int *data;
+  long length;          /* numbers in 'data' */
+  long capacity;        /* numbers 'data' has room for */
+} int_array;
+
+
+/* Make an int_array empty, without freeing anything. */
+void init_int_array(int_array *a);
+
+/* Free the numbers of an int_array and make it empty. */
+void free_int_array(int_array *a);
+
+/* Make room for at least 'capacity' numbers in an int_array. */
+void reserve_ints(int_array *a, long capacity);
+
+/* Add a number to the end of an int_array. */
+void add_int(int_array *a, int value);
+
+/*
+ * Reads numbers from a file a few at a time, for input that need not fit
+ * in memory.  A call may stop in the middle of a text number; what has
+ * been read of it is kept here for the next call, as are the first bytes
+ * of a binary number.
+ */
+
+typedef struct
+{
+  FILE *fp;
+  int binary;
+  char buffer[IO_BUFFER_SIZE];
+  size_t pos;           /* the next byte of 'buffer' to read */
+  size_t end;           /* bytes in 'buffer' */
+  int at_end;           /* set once 'fp' has no more input */
+  int in_number;        /* set while in a text number */
+  int negative;
+  int digits;           /* digits of the number so far */
+  unsigned long value;  /* their value, without the sign */
+} int_reader;
+
+/* Writes numbers to a file a few at a time, through a buffer. */
+
+typedef struct
+{
+  FILE *fp;
+  int binary;
+  char buffer[IO_BUFFER_SIZE];
+  size_t used;          /* bytes in 'buffer' */
+} int_writer;
+
+
+/*
+ * Read all the numbers from 'fp' and add them to 'a'.  Text numbers are
+ * separated by white space and may have a sign.  Return 0 on success,
+ * or -1 on a read error, on text that is not a number, on a number that
+ * does not fit in an int, or on binary input whose length is not a
+ * multiple of 4 bytes.
+ */
+int read_ints(FILE *fp, int binary, int_array *a);
+
+/*
+ * Write 'n' numbers to 'fp', one per line like 'printf("%d\n")' if not
+ * binary.  Return 0 on success or -1 on a write error.
+ */
+int write_ints(FILE *fp, int *a, long n, int binary);
+
+/* Start reading numbers from 'fp', as text or binary. */
+void init_int_reader(int_reader *r, FILE *fp, int binary);
+
+/*
+ * Read up to 'max' numbers, at least 1, into 'a'.  Return how many were
+ * read, which is less than 'max' only at the end of the input and 0
+ * after it, or -1 on the errors of 'read_ints'.
+ */
+long read_some_ints(int_reader *r, int *a, long max);
+
+/* Start writing numbers to 'fp', as text or binary. */
+void init_int_writer(int_writer *w, FILE *fp, int binary);
+
+/*
+ * Write 'n' numbers like 'write_ints', but keep the last of them in the
+ * buffer.  Return 0 on success or -1 on a write error.
+ */
+int write_some_ints(int_writer *w, int *a, long n);
+
+/* Write out the buffer and flush the file.  Return 0 or -1. */
+int flush_int_writer(int_writer *w);
+
+#endif  /* INT_IO_H */
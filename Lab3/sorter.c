@@ -2,16 +2,25 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include "array_sort.h"
+#include "parallel_sort.h"
+#include "int_io.h"
+#include "external_sort.h"
 #define MAX_LENGTH  32
 
 /* The sorter function sorts a lists of integers and prints them in increasing
- *     order, based on the bubble sort or minimum element algorithms. 
- *     Arguments: between 1 and 32 integers, [-b], [-q]
+ *     order, based on the bubble sort or minimum element algorithms, or
+ *     with the parallel merge sort or the radix sort, or with the external
+ *     sort for files larger than the memory.
+ *     Arguments: between 1 and 32 integers, [-b], [-q], [-p], [-j threads],
+ *         [-r], [-x], [-M megabytes], [-f file], [-B]
  *     Returns: Printed list of integers in increasing order
  */
 
 void sorting_minimum_element(int input_array[], int length_array);
 void sorting_bubble_sort(int input_array[], int length_array);
+void sort_externally(FILE *fp, char *input, int quiet, int binary,
+                     long memory);
 
 int main(int argc, char *argv[])
 {
@@ -19,7 +28,18 @@ int main(int argc, char *argv[])
     int i;
     int quiet = 0;
     int sorting_bubble = 0;
+    int sorting_parallel = 0;
+    int sorting_radix = 0;
+    int nthreads = 0;
     int length_array = 0;
+    int binary = 0;
+    int external = 0;
+    long memory = EXTERNAL_SORT_MEMORY;
+    char *input = NULL;       /* the file to read numbers from, if any */
+    FILE *fp;
+    int_array file_numbers;   /* the numbers, when there is a file */
+    int *numbers;             /* the numbers to sort */
+    long length;
 
     /*
      * We will analyze the command line input by checking for -q and -b tags, 
@@ -28,6 +48,15 @@ int main(int argc, char *argv[])
      *     `-q` indicates the program will not print any output
      *     `-b` indicates the sorting algorithm will be bubble sort instead
      *         of minimum element. 
+     *     `-p` sorts with the parallel merge sort on all processors,
+     *     `-j` sets its number of threads,
+     *     `-r` sorts with the radix sort,
+     *     `-x` sorts the file with the external sort instead, which
+     *         keeps within `-M` megabytes of memory however large the
+     *         file is,
+     *     `-f` reads any number of numbers from a file, or from the
+     *         standard input if the file is `-`, and
+     *     `-B` reads and writes the numbers as 4-byte binary ints.
      */
     for (i = 1; i < argc; i++)
     {
@@ -39,64 +68,219 @@ int main(int argc, char *argv[])
         {
             sorting_bubble = 1;  
         }
+        else if (strcmp(argv[i], "-p") == 0)
+        {
+            sorting_parallel = 1;
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            nthreads = atoi(argv[++i]);
+            sorting_parallel = 1;
+        }
+        else if (strcmp(argv[i], "-r") == 0)
+        {
+            sorting_radix = 1;
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            input = argv[++i];
+        }
+        else if (strcmp(argv[i], "-x") == 0)
+        {
+            external = 1;
+        }
+        else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc)
+        {
+            memory = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-B") == 0)
+        {
+            binary = 1;
+        }
         else
         {
-            array_integers[length_array] = atoi(argv[i]);
-            ++length_array;
              /*
-            * Checking that there are no more than 32 input numbers. Otherwise,
-            *     the program exits.
+            * Checking that there are no more than 32 input numbers, before
+            *     storing one more. Otherwise, the program exits.
             */
-            if (length_array > MAX_LENGTH)
+            if (length_array == MAX_LENGTH)
             {
                 fprintf(
                     stderr,
-                    "usage: %s [-b] [-q] num1 [num2 ...] (max 32 numbers)\n",
+                    "usage: %s [-b] [-q] [-p] [-j threads] [-r] [-B] "
+                    "[-f file] num1 [num2 ...] (max 32 numbers)\n",
                     argv[0]
                 );
                 exit(1);
             }
+            array_integers[length_array] = atoi(argv[i]);
+            ++length_array;
+        }
+    }
+
+    /*
+     * The external sort takes its numbers from a file only, and prints
+     *     them as it merges them, so it is done here.
+     */
+    if (external)
+    {
+        if (input == NULL || length_array > 0 || memory <= 0)
+        {
+            fprintf(
+                stderr,
+                "usage: %s [-q] [-B] [-M megabytes] -x -f file\n",
+                argv[0]
+            );
+            exit(1);
+        }
+
+        fp = (strcmp(input, "-") == 0) ? stdin : fopen(input, "rb");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Error! Cannot open %s!\n", input);
+            exit(1);
+        }
+        sort_externally(fp, input, quiet, binary, memory);
+        if (fp != stdin)
+        {
+            fclose(fp);
+        }
+        return 0;
+    }
+
+    /*
+     * Reading the numbers from the file, if any, after the numbers in the
+     *     arguments.  A file may hold any number of numbers.
+     */
+    numbers = array_integers;
+    length = length_array;
+    if (input != NULL)
+    {
+        init_int_array(&file_numbers);
+        for (i = 0; i < length_array; i++)
+        {
+            add_int(&file_numbers, array_integers[i]);
+        }
+
+        fp = (strcmp(input, "-") == 0) ? stdin : fopen(input, "rb");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Error! Cannot open %s!\n", input);
+            exit(1);
+        }
+        if (read_ints(fp, binary, &file_numbers) != 0)
+        {
+            fprintf(stderr, "Error! %s does not hold only numbers!\n",
+                    (fp == stdin) ? "The standard input" : input);
+            exit(1);
+        }
+        if (fp != stdin)
+        {
+            fclose(fp);
         }
+
+        numbers = file_numbers.data;
+        length = file_numbers.length;
     }
 
     /*
      * Checking that there is at least 1 input number. Otherwise,
      *     the program exits.
      */
-    if (length_array == 0)
+    if (length == 0)
     {
         fprintf(
             stderr,
-            "usage: %s [-b] [-q] number1 [number2 ...] (maximum 32 numbers)\n",
+            "usage: %s [-b] [-q] [-p] [-j threads] [-r] [-B] [-f file] "
+            "number1 [number2 ...] (maximum 32 numbers)\n",
             argv[0]
         );
         exit(1);
     }
 
     /*
-     * Sorting the numbers with the default minimum element sorting function
-     *    or the bubble sort.
+     * Sorting the numbers with the default minimum element sorting function,
+     *    the bubble sort, the radix sort or the parallel merge sort.
+     *    The minimum element sort takes O(N^2) time, so numbers from a
+     *    file are sorted with the introsort by default instead.
      */
-    if (sorting_bubble == 0)
+    if (sorting_radix)
     {
-        sorting_minimum_element(array_integers, length_array);
+        radix_sort_ints(numbers, length);
+        assert(ints_sorted(numbers, length));
+    }
+    else if (sorting_parallel)
+    {
+        if (nthreads <= 0)
+        {
+            nthreads = processors_online();
+        }
+        parallel_sort(numbers, length, nthreads, PARALLEL_SORT_THRESHOLD);
+        assert(ints_sorted(numbers, length));
+    }
+    else if (sorting_bubble == 0 && input != NULL)
+    {
+        introsort(numbers, length);
+        assert(ints_sorted(numbers, length));
+    }
+    else if (sorting_bubble == 0)
+    {
+        sorting_minimum_element(numbers, (int)length);
     }
     else
     {
-        sorting_bubble_sort(array_integers, length_array);
+        sorting_bubble_sort(numbers, (int)length);
     }
     
     /*
      * Printing the ordered input array of numbers from lowest to highest.
      */
-    if (quiet == 0)
+    if (quiet == 0 && write_ints(stdout, numbers, length, binary) != 0)
     {
-        for (i = 0; i < length_array; i++)
-            printf("%d\n", array_integers[i]);
+        fprintf(stderr, "Error! Cannot write the sorted numbers!\n");
+        exit(1);
+    }
+
+    if (input != NULL)
+    {
+        free_int_array(&file_numbers);
     }
     return 0;    
 }
 
+/* The function `sort_externally` sorts the numbers of a file with the
+ *     external sort and prints them, unless `quiet` is set.  At most
+ *     about `memory` megabytes are used, so the file can be larger than
+ *     the memory.
+ *     Arguments: the open file, its name, the flags and the megabytes
+ *     Returns: nothing; exits on an error
+ */
+void sort_externally(FILE *fp, char *input, int quiet, int binary,
+                     long memory)
+{
+    int result;
+
+    result = external_sort(fp, quiet ? NULL : stdout, binary,
+                           memory << 20);
+
+    if (result == EXTERNAL_SORT_BAD_INPUT)
+    {
+        fprintf(stderr, "Error! %s does not hold only numbers!\n",
+                (fp == stdin) ? "The standard input" : input);
+        exit(1);
+    }
+    if (result == EXTERNAL_SORT_WRITE_ERROR)
+    {
+        fprintf(stderr, "Error! Cannot write the sorted numbers!\n");
+        exit(1);
+    }
+    if (result == EXTERNAL_SORT_TEMP_ERROR)
+    {
+        fprintf(stderr, "Error! Cannot write the temporary files!\n");
+        exit(1);
+    }
+}
+
 /* The function `sorting_minimum_element` uses the minimum element sorting
  *     algorithm to sort the elements in a list.
  *     Arguments: integer array of numbers, length of the array - 1
@@ -5,9 +5,16 @@
  *
  */
 
+/* Needed for pthreads and sigaction under -ansi. */
+#define _POSIX_C_SOURCE 200112L
+#define _XOPEN_SOURCE 600
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
 
 #define MEMCHECK_C
 #include "memcheck.h"
@@ -25,321 +32,2128 @@ struct _mem_node
     size_t  nbytes;     /* Number of bytes allocated.                     */
     char   *filename;   /* Name of file where allocation occurred.        */
     int     lineno;     /* Line number of file where allocation occurred. */
-    struct _mem_node *next;     /* Next node in linked list. */
+    unsigned long seq;  /* Order of the allocation, over all threads.     */
+    struct _mem_site *site;     /* Call site, when profiling. */
+    size_t  front;      /* Bytes before 'addr' in the real block.         */
+    char   *freed_file; /* Where it was freed, while in the quarantine.   */
+    int     freed_line;
+    struct _mem_node *next;     /* Next node in a free list. */
 }
 mem_node;
 
 
+/*
+ * The live nodes are kept in an open-addressing hash table keyed by
+ * address, so that finding and removing the node of a freed pointer
+ * takes constant time.  To let several threads allocate and free at
+ * once, the table is split into MEM_SHARDS shards, each with its own
+ * lock; the low bits of an address's hash pick the shard and the rest
+ * pick the slot.  Each shard uses linear probing and is kept at most
+ * half full.
+ */
+
+#define MEM_SHARD_BITS     6
+#define MEM_SHARDS         (1 << MEM_SHARD_BITS)
+#define INDEX_INITIAL_SIZE 64
+
+typedef
+struct _mem_shard
+{
+    pthread_mutex_t lock;
+    mem_node **slots;   /* 'size' slots (a power of two), or NULL. */
+    size_t     size;
+    size_t     count;   /* Number of slots in use. */
+}
+mem_shard;
+
+
+/*
+ * Memory nodes are carved out of slabs of NODES_PER_SLAB nodes.  Each
+ * thread keeps its own list of free nodes, so recording an allocation
+ * normally takes no lock and does not call 'malloc'.  A thread that
+ * frees more nodes than it allocates hands the extra ones back to a
+ * shared list, where other threads pick them up before making a new
+ * slab.
+ */
+
+#define NODES_PER_SLAB 1024
+
+typedef
+struct _node_slab
+{
+    struct _node_slab *next;            /* Next slab in linked list. */
+    mem_node nodes[NODES_PER_SLAB];
+}
+node_slab;
+
+
+/*
+ * When the environment variable MEMCHECK_PROFILE is set, every call
+ * site (file name and line) that allocates memory gets a record of how
+ * often it was called, how many bytes it asked for, and how many of
+ * them were live at once.  Sizes are counted in PROFILE_BUCKETS
+ * buckets: bucket 0 holds sizes up to 1 byte, bucket 'b' sizes up to
+ * 2^b, and the last one everything larger.  The file name is compared
+ * by pointer, since it always comes from __FILE__.
+ */
+
+#define PROFILE_BUCKETS   16
+#define SITES_INITIAL_SIZE 256
+
+typedef
+struct _mem_site
+{
+    char   *filename;
+    int     lineno;
+    unsigned long calls;        /* Number of allocations.           */
+    unsigned long bytes;        /* Total bytes allocated.           */
+    unsigned long live;         /* Bytes allocated and not freed.   */
+    unsigned long peak;         /* Highest value 'live' reached.    */
+    unsigned long hist[PROFILE_BUCKETS];
+}
+mem_site;
+
+
+/*
+ * When the environment variable MEMCHECK_GUARD is set, every block gets
+ * GUARD_SIZE bytes of GUARD_BYTE before and after the memory handed
+ * out, which are checked when the block is freed and at exit.  Freed
+ * blocks are filled with FREED_BYTE and held in a quarantine (oldest
+ * first) instead of being freed; their nodes stay in the index, marked
+ * with where they were freed, so a second free is caught at once.
+ * When more than QUARANTINE_BYTES are held, the oldest blocks are
+ * checked for writes after the free and really freed.
+ */
+
+#define GUARD_SIZE       16     /* Keeps the alignment of 'malloc'. */
+#define GUARD_BYTE       0xab
+#define FREED_BYTE       0xdd
+#define QUARANTINE_BYTES (4UL << 20)
+
+
+/*
+ * A snapshot of the live memory, totalled by call site and sorted by
+ * file name pointer and line so that two snapshots can be merged.
+ */
+
+typedef
+struct _site_total
+{
+    char   *filename;
+    int     lineno;
+    unsigned long bytes;
+    unsigned long blocks;
+}
+site_total;
+
+struct _memcheck_snapshot
+{
+    memcheck_stats stats;
+    site_total    *sites;
+    size_t         nsites;
+};
+
+typedef
+struct _site_change
+{
+    site_total *site;           /* The site in either snapshot. */
+    long        bytes;
+    long        blocks;
+}
+site_change;
+
+
 /*
  * Function prototypes.
  */
 
-void        allocate_mem_node(void *addr, size_t nbytes,
+void        memcheck_init(void);
+void        allocate_mem_node(void *addr, size_t nbytes, size_t front,
                               char *filename, int lineno);
 void        free_mem_node(mem_node *n);
-void        free_mem_node_and_adjust_pool(mem_node *n);
 void        free_all_mem_nodes(void);
-mem_node   *find_node(void *addr);
+mem_node   *find_node(mem_shard *s, void *addr);
+unsigned long mem_index_hash(void *addr);
+mem_shard  *mem_index_shard(void *addr);
+size_t      mem_index_home(mem_shard *s, void *addr);
+void        mem_index_insert(mem_shard *s, mem_node *n);
+void        mem_index_remove(mem_shard *s, mem_node *n);
+void        mem_index_grow(mem_shard *s);
+void        check_node_cache(void);
+void        return_node_cache(void *unused);
+void        refill_node_cache(void);
+void        release_node_cache(void);
+mem_node   *get_mem_node(void);
+void        put_mem_node(mem_node *n);
+void        free_node_slabs(void);
+int         compare_mem_nodes(const void *a, const void *b);
+void        request_profile(int sig);
+int         size_bucket(size_t nbytes);
+mem_site   *find_site(char *filename, int lineno);
+void        profile_alloc(mem_node *n);
+void        profile_free(mem_node *n);
+int         compare_sites(const void *a, const void *b);
+void        print_allocation_profile(void);
+int         guard_mode(void);
+void       *guarded_alloc(size_t size, size_t alignment, int zero,
+                          char *filename, int lineno);
+char       *check_mem_node(mem_node *n, int freed);
+void        report_mem_error(char *what, mem_node *n);
+void        quarantine_mem_node(mem_node *n);
+void        release_mem_node(mem_node *n);
+void        count_alloc(size_t nbytes);
+void        count_free(size_t nbytes);
+int         compare_site_totals(const void *a, const void *b);
+int         compare_site_changes(const void *a, const void *b);
 void       *checked_malloc_fn(size_t size, char *filename, int lineno);
 void       *checked_calloc_fn(size_t nmemb, size_t size,
                               char *filename, int lineno);
+void       *checked_realloc_fn(void *ptr, size_t size,
+                               char *filename, int lineno);
+char       *checked_strdup_fn(const char *s, char *filename, int lineno);
+void       *checked_aligned_alloc_fn(size_t alignment, size_t size,
+                                     char *filename, int lineno);
+int         checked_posix_memalign_fn(void **memptr, size_t alignment,
+                                      size_t size, char *filename,
+                                      int lineno);
 void        checked_free_fn(void *ptr, char *filename, int lineno);
 void        print_memory_leaks(void);
+void        get_memcheck_stats(memcheck_stats *stats);
+void        print_memcheck_stats(void);
+memcheck_snapshot *take_memcheck_snapshot(void);
+void        free_memcheck_snapshot(memcheck_snapshot *snap);
+void        print_memcheck_snapshot_diff(memcheck_snapshot *before,
+                                         memcheck_snapshot *after);
 void        dump_pool(void);
 
 
 /*
- * Initialize the memory pool linked list as a global variable.
+ * The shards of the address index.  Their locks are set up on first
+ * use, through 'memcheck_init'.
  */
 
-mem_node *pool = NULL;
+mem_shard      mem_shards[MEM_SHARDS];
+pthread_once_t mem_once = PTHREAD_ONCE_INIT;
 
 
-/**********************************************************************
- *
- * Low-level functions for managing the memory pool linked list.
- *
- **********************************************************************/
+/*
+ * Allocation counter.  Every node gets the next number, so the leak
+ * report can list the allocations of all threads newest first.
+ */
+
+unsigned long mem_sequence = 0;
+
+
+/*
+ * Heap counters, kept with atomic operations on every allocation and
+ * free so that they can be read at any time.  A free in guard mode
+ * counts when the block enters the quarantine.
+ */
+
+unsigned long mem_live_bytes   = 0;
+unsigned long mem_peak_bytes   = 0;
+unsigned long mem_total_allocs = 0;
+unsigned long mem_total_frees  = 0;
+
+
+/*
+ * The slabs of memory nodes and the shared list of free nodes, both
+ * guarded by 'slab_lock'.  'mem_generation' goes up each time the slabs
+ * are freed, which tells every thread that its own list is stale.
+ */
+
+pthread_mutex_t slab_lock   = PTHREAD_MUTEX_INITIALIZER;
+node_slab      *node_slabs  = NULL;
+mem_node       *spare_nodes = NULL;
+unsigned long   mem_generation = 0;
+
+
+/*
+ * Each thread's own list of free nodes.  'node_cache_key' has a
+ * destructor that gives the list back to the shared one when the thread
+ * exits; 'node_cache_registered' is set once the thread has set the key,
+ * which it does on its first use of the list.
+ */
+
+__thread mem_node     *free_nodes = NULL;
+__thread size_t        free_node_count = 0;
+__thread unsigned long free_node_generation = 0;
+__thread int           node_cache_registered = 0;
+pthread_key_t          node_cache_key;
+
+
+/*
+ * The number of node slabs, for 'get_memcheck_stats'.  Guarded by
+ * 'slab_lock'.
+ */
+
+unsigned long mem_node_slabs = 0;
+
+
+/*
+ * The call site records, in an open-addressing hash table guarded by
+ * 'site_lock'.  'mem_profiling' is set when MEMCHECK_PROFILE is, and
+ * 'profile_by_calls' when its value is "calls".  'profile_requested'
+ * is set by SIGUSR1 and makes the next allocation print the report.
+ */
+
+pthread_mutex_t site_lock  = PTHREAD_MUTEX_INITIALIZER;
+mem_site      **site_table = NULL;
+size_t          site_table_size = 0;
+size_t          site_count = 0;
+int             mem_profiling    = 0;
+int             profile_by_calls = 0;
+volatile sig_atomic_t profile_requested = 0;
+
 
 /*
- * Allocate a memory node, set its values and link it into the memory
- * pool linked list.
+ * The quarantine of freed blocks, linked through 'next' from oldest to
+ * newest and guarded by 'quarantine_lock'.  'mem_guarding' is set when
+ * MEMCHECK_GUARD is.
+ */
+
+pthread_mutex_t quarantine_lock  = PTHREAD_MUTEX_INITIALIZER;
+mem_node       *quarantine_head  = NULL;
+mem_node       *quarantine_tail  = NULL;
+size_t          quarantine_bytes = 0;
+int             mem_guarding     = 0;
+
+
+/*
+ * Set up the locks of the index shards, the key that returns the free
+ * nodes of exiting threads, and the profiler and the guard zones if they
+ * are asked for.  Run once, by 'pthread_once'.
  */
 
 void
-allocate_mem_node(void *addr, size_t nbytes, char *filename, int lineno)
+memcheck_init(void)
 {
-    mem_node *n;
-    char *fn;
+    struct sigaction sa;
+    char *mode;
+    int i;
+
+    for (i = 0; i < MEM_SHARDS; i++)
+    {
+        pthread_mutex_init(&mem_shards[i].lock, NULL);
+        mem_shards[i].slots = NULL;
+        mem_shards[i].size  = 0;
+        mem_shards[i].count = 0;
+    }
 
-    /* Create the node and set its fields. */
-    n = (mem_node *)malloc(sizeof(mem_node));
+    pthread_key_create(&node_cache_key, return_node_cache);
 
-    if (n == NULL)
+    mode = getenv("MEMCHECK_PROFILE");
+    if (mode != NULL && mode[0] != '\0' && strcmp(mode, "0") != 0)
     {
-        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
-        exit(1);
+        mem_profiling    = 1;
+        profile_by_calls = (strcmp(mode, "calls") == 0);
+
+        /* Report at exit, and whenever SIGUSR1 arrives. */
+        atexit(print_allocation_profile);
+
+        sa.sa_handler = request_profile;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &sa, NULL);
     }
 
-#if DEBUG == 1
-    fprintf(stderr, "Allocating %d bytes of memory at %p\n",
-            nbytes, addr);
-#endif
+    mode = getenv("MEMCHECK_GUARD");
+    mem_guarding = (mode != NULL && mode[0] != '\0'
+                    && strcmp(mode, "0") != 0);
+}
 
-    /* Copy the filename, which is statically allocated (I think). */
-    fn = (char *)malloc((strlen(filename) + 1) * sizeof(char));
-    strcpy(fn, filename);
 
-    n->addr     = addr;
-    n->nbytes   = nbytes;
-    n->filename = fn;
-    n->lineno   = lineno;
+/**********************************************************************
+ *
+ * Functions for managing the memory node slabs.
+ *
+ **********************************************************************/
+
+/*
+ * Drop this thread's free list if the slabs it points into have been
+ * freed since it was filled.  On the first use of the list, set the key
+ * whose destructor gives it back when the thread exits.
+ */
+
+void
+check_node_cache(void)
+{
+    if (!node_cache_registered)
+    {
+        pthread_once(&mem_once, memcheck_init);
+        pthread_setspecific(node_cache_key, &free_nodes);
+        node_cache_registered = 1;
+    }
 
-    /* Add it to the front of the memory pool. */
-    n->next = pool;
-    pool    = n;
+    if (free_node_generation != mem_generation)
+    {
+        free_nodes = NULL;
+        free_node_count = 0;
+        free_node_generation = mem_generation;
+    }
 }
 
 
 /*
- * Free a memory node from the pool.
+ * Move all of an exiting thread's free list to the shared list, so that
+ * other threads can use its nodes.  Without this, every thread that ever
+ * allocated would strand up to two slabs of nodes.  Run as the
+ * destructor of 'node_cache_key'; a list from before the slabs were
+ * last freed is just dropped.
  */
 
 void
-free_mem_node(mem_node *n)
+return_node_cache(void *unused)
 {
-    if (n != NULL)
+    mem_node *last;
+
+    (void)unused;
+    node_cache_registered = 0;
+
+    pthread_mutex_lock(&slab_lock);
+    if (free_nodes != NULL && free_node_generation == mem_generation)
     {
-        if (n->addr == NULL)
+        for (last = free_nodes; last->next != NULL; last = last->next)
         {
-            fprintf(stderr, "ERROR: invalid node at: %p\n", n->addr);
-            return;
+            ;
         }
-
-#if DEBUG == 1
-        fprintf(stderr, "Freeing memory at %p\n", n->addr);
-#endif
-
-        free(n->addr);
-        free(n->filename);
-        free(n);
+        last->next = spare_nodes;
+        spare_nodes = free_nodes;
     }
+    pthread_mutex_unlock(&slab_lock);
+
+    free_nodes = NULL;
+    free_node_count = 0;
 }
 
 
 /*
- * Free a memory node from the pool.  Adjust the 'next' pointer of the
- * previous node (if any) to skip over this node.
+ * Fill this thread's empty free list, from the shared list if it has
+ * any nodes and from a new slab otherwise.
  */
 
 void
-free_mem_node_and_adjust_pool(mem_node *n)
+refill_node_cache(void)
 {
-    mem_node *p, *prev;
+    node_slab *slab;
+    mem_node *n;
+    int i;
 
-    prev = NULL;
+    pthread_mutex_lock(&slab_lock);
 
-    for (p = pool; p != NULL; p = p->next)
+    if (spare_nodes != NULL)
     {
-        if (p->addr == n->addr)
+        /* Take up to a slab's worth of nodes off the shared list. */
+        free_nodes = spare_nodes;
+        for (i = 1, n = spare_nodes; i < NODES_PER_SLAB && n->next != NULL;
+             i++, n = n->next)
         {
-            if (prev == NULL)
-            {
-                /* The node to be removed is the first node. */
-                pool = p->next;
-                free_mem_node(p);
-                break;   /* Nothing left to do. */
-            }
-            else
-            {
-                /*
-                 * The node is in the interior of the memory pool
-                 * linked list.  Adjust the 'next' pointer of the
-                 * previous node and free the node.
-                 */
-                prev->next = p->next;
-                free_mem_node(p);
-                break;   /* Nothing left to do. */
-            }
+            ;
         }
-        else
+        spare_nodes = n->next;
+        n->next = NULL;
+        free_node_count = i;
+    }
+    else
+    {
+        slab = (node_slab *)malloc(sizeof(node_slab));
+
+        if (slab == NULL)
+        {
+            fprintf(stderr, "ERROR: memory allocation failed!  "
+                            "Aborting...\n");
+            exit(1);
+        }
+
+        slab->next = node_slabs;
+        node_slabs = slab;
+        mem_node_slabs++;
+
+        for (i = NODES_PER_SLAB - 1; i >= 0; i--)
         {
-            prev = p;
+            slab->nodes[i].next = free_nodes;
+            free_nodes = &slab->nodes[i];
         }
+        free_node_count = NODES_PER_SLAB;
     }
+
+    pthread_mutex_unlock(&slab_lock);
 }
 
 
 /*
- * Free all the memory nodes from the pool.
+ * Move a slab's worth of nodes from this thread's free list to the
+ * shared list.
  */
 
 void
-free_all_mem_nodes(void)
+release_node_cache(void)
 {
-    mem_node *n, *next;
+    mem_node *first, *last;
+    int i;
 
-    n = pool;
-
-    while (n != NULL)
+    first = free_nodes;
+    for (i = 1, last = first; i < NODES_PER_SLAB; i++)
     {
-        next = n->next;
-        free_mem_node(n);
-        n = next;
+        last = last->next;
     }
+    free_nodes = last->next;
+    free_node_count -= NODES_PER_SLAB;
+
+    pthread_mutex_lock(&slab_lock);
+    last->next = spare_nodes;
+    spare_nodes = first;
+    pthread_mutex_unlock(&slab_lock);
 }
 
 
 /*
- * Return the node that corresponds to the address 'addr', or NULL if
- * the address isn't found.
+ * Take a memory node from this thread's free list, refilling it first
+ * if it is empty.
  */
 
 mem_node *
-find_node(void *addr)
+get_mem_node(void)
 {
     mem_node *n;
 
-    for (n = pool; n != NULL; n = n->next)
+    check_node_cache();
+
+    if (free_nodes == NULL)
     {
-        if (n->addr == addr)
-        {
-            return n;
-        }
+        refill_node_cache();
     }
 
-    return NULL;
+    n = free_nodes;
+    free_nodes = n->next;
+    free_node_count--;
+    return n;
 }
 
 
 /*
- * A debugging function to print the contents of the memory pool
- * linked list.
+ * Put a memory node back on this thread's free list.
  */
 
 void
-dump_pool(void)
+put_mem_node(mem_node *n)
 {
-    mem_node *n;
+    check_node_cache();
+
+    n->next = free_nodes;
+    free_nodes = n;
+    free_node_count++;
 
-    for (n = pool; n != NULL; n = n->next)
+    if (free_node_count > 2 * NODES_PER_SLAB)
     {
-        fprintf(stderr, "NODE --------\n");
-        fprintf(stderr, "location: %p\n", (void *)n);
-        fprintf(stderr, "addr: %p\n", n->addr);
-        fprintf(stderr, "nbytes: %d\n", (int)n->nbytes);
-        fprintf(stderr, "filename: %s\n", n->filename);
-        fprintf(stderr, "line number: %d\n", n->lineno);
-        fprintf(stderr, "next: %p\n", (void *)n->next);
-        fprintf(stderr, "\n");
+        release_node_cache();
+    }
+}
+
+
+/*
+ * Free all the slabs.  Only safe when no memory node is in use.
+ */
+
+void
+free_node_slabs(void)
+{
+    node_slab *slab, *next;
+
+    pthread_mutex_lock(&slab_lock);
+
+    for (slab = node_slabs; slab != NULL; slab = next)
+    {
+        next = slab->next;
+        free(slab);
     }
+
+    node_slabs  = NULL;
+    spare_nodes = NULL;
+    mem_node_slabs = 0;
+    mem_generation++;
+
+    pthread_mutex_unlock(&slab_lock);
 }
 
 
 /**********************************************************************
  *
- * User-level functions.
+ * Functions for managing the address index.
  *
- * NOTE: Normally, the user will not use these functions, but will
- *       use 'malloc' and 'calloc' wrappers defined in "memcheck.h".
+ * NOTE: Apart from 'mem_index_hash' and 'mem_index_shard', these must
+ *       be called with the lock of the shard held.
  *
  **********************************************************************/
 
+/*
+ * Return the hash of an address.  The low bits of an address are always
+ * zero because of alignment, so they are shifted out, and the high bits
+ * of the product with a large odd constant are folded into the low bits.
+ */
+
+unsigned long
+mem_index_hash(void *addr)
+{
+    unsigned long h = (unsigned long) addr;
+
+    h = (h >> 4) * 2654435761UL;
+    h ^= h >> 15;
+    return h;
+}
+
 
 /*
- * Allocate 'size' bytes of memory.  Also add the address, filename, and line
- * number as a new node in the memory pool linked list.
+ * Return the shard that holds (or would hold) the node of 'addr'.
  */
 
-void *
-checked_malloc_fn(size_t size, char *filename, int lineno)
+mem_shard *
+mem_index_shard(void *addr)
 {
-    void *mem;
+    pthread_once(&mem_once, memcheck_init);
+    return &mem_shards[mem_index_hash(addr) & (MEM_SHARDS - 1)];
+}
 
-    mem = malloc(size);
 
-    if (mem == NULL)
-    {
-        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
-        exit(1);
-    }
+/*
+ * Return the slot of shard 's' where the search for 'addr' starts.
+ */
 
-    allocate_mem_node(mem, size, filename, lineno);
-    return mem;
+size_t
+mem_index_home(mem_shard *s, void *addr)
+{
+    return (size_t) (mem_index_hash(addr) >> MEM_SHARD_BITS)
+           & (s->size - 1);
 }
 
 
 /*
- * This function is the same as 'checked_malloc' except that it has
- * a different signature (corresponding to 'calloc' in the first two
- * arguments) and zeroes out all the allocated memory.
+ * Double the size of a shard (or create it) and reinsert every node.
  */
 
-void *
-checked_calloc_fn(size_t nmemb, size_t size, char *filename, int lineno)
+void
+mem_index_grow(mem_shard *s)
 {
-    void *mem;
+    mem_node **old_slots = s->slots;
+    size_t old_size = s->size;
+    size_t i;
 
-    mem = calloc(nmemb, size);
+    s->size = (old_size == 0) ? INDEX_INITIAL_SIZE : 2 * old_size;
+    s->slots = (mem_node **)calloc(s->size, sizeof(mem_node *));
 
-    if (mem == NULL)
+    if (s->slots == NULL)
     {
         fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
         exit(1);
     }
 
-    allocate_mem_node(mem, (nmemb * size), filename, lineno);
-    return mem;
+    s->count = 0;
+    for (i = 0; i < old_size; i++)
+    {
+        if (old_slots[i] != NULL)
+        {
+            mem_index_insert(s, old_slots[i]);
+        }
+    }
+
+    free(old_slots);
 }
 
 
 /*
- * Free a pointer that was previously allocated by 'checked_malloc()'.  If
- * the memory being freed is not found in the memory pool, print an error
- * message and abort.
+ * Add a node to a shard.
  */
 
 void
-checked_free_fn(void *ptr, char *filename, int lineno)
+mem_index_insert(mem_shard *s, mem_node *n)
 {
-    mem_node *n = find_node(ptr);
+    size_t i;
 
-    if (n == NULL)
+    if (2 * (s->count + 1) > s->size)
     {
-        fprintf(stderr,
-                "ERROR: invalid attempt to free unallocated memory at %p "
-                "in file: %s, line: %d\n", ptr, filename, lineno);
-        fprintf(stderr, "Aborting...\n");
-        free_all_mem_nodes();
-        exit(1);
+        mem_index_grow(s);
     }
-    else
+
+    for (i = mem_index_home(s, n->addr); s->slots[i] != NULL;
+         i = (i + 1) & (s->size - 1))
     {
-        free_mem_node_and_adjust_pool(n);
+        ;
     }
+
+    s->slots[i] = n;
+    s->count++;
 }
 
 
 /*
- * This function is intended to be called at the end of a program only.
- * It goes through the memory pool node-by-node and prints out information
- * on the contents of the node.  Any nodes that exist at the end of the
- * program represent leaked memory.
+ * Remove a node from a shard.  The nodes after it in the same probe
+ * run are shifted back into the hole, so no deleted-slot markers are
+ * needed and lookups never slow down.
  */
 
 void
-print_memory_leaks(void)
+mem_index_remove(mem_shard *s, mem_node *n)
 {
-    mem_node *n;
+    size_t mask = s->size - 1;
+    size_t hole, i, home;
 
-    for (n = pool; n != NULL; n = n->next)
+    for (hole = mem_index_home(s, n->addr); s->slots[hole] != n;
+         hole = (hole + 1) & mask)
     {
-        fprintf(stderr,
-                "Memory leak: %d bytes allocated at %p in "
-                "file: %s, line: %d.\n",
-                (int)n->nbytes, n->addr, n->filename, n->lineno);
+        ;
     }
 
-    free_all_mem_nodes();
+    for (i = (hole + 1) & mask; s->slots[i] != NULL; i = (i + 1) & mask)
+    {
+        home = mem_index_home(s, s->slots[i]->addr);
+
+        /* Move the node back unless its home lies in (hole, i]. */
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            s->slots[hole] = s->slots[i];
+            hole = i;
+        }
+    }
+
+    s->slots[hole] = NULL;
+    s->count--;
+}
+
+
+/**********************************************************************
+ *
+ * Functions for the allocation profiler.
+ *
+ **********************************************************************/
+
+/*
+ * Signal handler for SIGUSR1.  Printing is not safe in a handler, so
+ * this only sets a flag.
+ */
+
+void
+request_profile(int sig)
+{
+    (void) sig;
+    profile_requested = 1;
 }
 
+
+/*
+ * Return the histogram bucket of an allocation of 'nbytes' bytes.
+ */
+
+int
+size_bucket(size_t nbytes)
+{
+    int b = 0;
+
+    while (b < PROFILE_BUCKETS - 1 && ((size_t) 1 << b) < nbytes)
+    {
+        b++;
+    }
+
+    return b;
+}
+
+
+/*
+ * Return the record of a call site, adding it if it is new.  Must be
+ * called with 'site_lock' held.
+ */
+
+mem_site *
+find_site(char *filename, int lineno)
+{
+    mem_site **old_table;
+    mem_site *site;
+    size_t old_size, mask, i, j;
+
+    /* Keep the table at most half full. */
+    if (2 * (site_count + 1) > site_table_size)
+    {
+        old_table = site_table;
+        old_size  = site_table_size;
+
+        site_table_size = (old_size == 0) ? SITES_INITIAL_SIZE
+                                          : 2 * old_size;
+        site_table = (mem_site **)calloc(site_table_size,
+                                         sizeof(mem_site *));
+
+        if (site_table == NULL)
+        {
+            fprintf(stderr, "ERROR: memory allocation failed!  "
+                            "Aborting...\n");
+            exit(1);
+        }
+
+        mask = site_table_size - 1;
+        for (j = 0; j < old_size; j++)
+        {
+            if ((site = old_table[j]) == NULL)
+            {
+                continue;
+            }
+
+            i = (mem_index_hash(site->filename) + site->lineno) & mask;
+            while (site_table[i] != NULL)
+            {
+                i = (i + 1) & mask;
+            }
+            site_table[i] = site;
+        }
+
+        free(old_table);
+    }
+
+    mask = site_table_size - 1;
+    for (i = (mem_index_hash(filename) + lineno) & mask;
+         (site = site_table[i]) != NULL; i = (i + 1) & mask)
+    {
+        if (site->filename == filename && site->lineno == lineno)
+        {
+            return site;
+        }
+    }
+
+    site = (mem_site *)calloc(1, sizeof(mem_site));
+
+    if (site == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    site->filename = filename;
+    site->lineno   = lineno;
+    site_table[i]  = site;
+    site_count++;
+
+    return site;
+}
+
+
+/*
+ * Count a new allocation against its call site.
+ */
+
+void
+profile_alloc(mem_node *n)
+{
+    mem_site *site;
+
+    pthread_mutex_lock(&site_lock);
+
+    site = find_site(n->filename, n->lineno);
+    site->calls++;
+    site->bytes += n->nbytes;
+    site->live  += n->nbytes;
+    if (site->live > site->peak)
+    {
+        site->peak = site->live;
+    }
+    site->hist[size_bucket(n->nbytes)]++;
+    n->site = site;
+
+    pthread_mutex_unlock(&site_lock);
+}
+
+
+/*
+ * Take a freed allocation off the live bytes of its call site.
+ */
+
+void
+profile_free(mem_node *n)
+{
+    pthread_mutex_lock(&site_lock);
+    n->site->live -= n->nbytes;
+    pthread_mutex_unlock(&site_lock);
+}
+
+
+/*
+ * Order call sites by total bytes (or by calls), largest first.
+ */
+
+int
+compare_sites(const void *a, const void *b)
+{
+    mem_site *sa = *(mem_site * const *)a;
+    mem_site *sb = *(mem_site * const *)b;
+    unsigned long ka, kb;
+
+    ka = profile_by_calls ? sa->calls : sa->bytes;
+    kb = profile_by_calls ? sb->calls : sb->bytes;
+    if (ka == kb)
+    {
+        ka = profile_by_calls ? sa->bytes : sa->calls;
+        kb = profile_by_calls ? sb->bytes : sb->calls;
+    }
+
+    return (ka < kb) - (ka > kb);
+}
+
+
+/*
+ * Print the call site records, ranked, to stderr.  The live column
+ * counts bytes not yet freed, so at exit it is the memory leaked from
+ * each site.
+ */
+
+void
+print_allocation_profile(void)
+{
+    mem_site **sites;
+    mem_site *site;
+    unsigned long calls, bytes;
+    size_t i, k;
+    int b;
+
+    pthread_once(&mem_once, memcheck_init);
+    if (!mem_profiling)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&site_lock);
+
+    sites = (mem_site **)malloc((site_count + 1) * sizeof(mem_site *));
+
+    if (sites == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    calls = bytes = 0;
+    for (i = k = 0; i < site_table_size; i++)
+    {
+        if ((site = site_table[i]) != NULL)
+        {
+            sites[k++] = site;
+            calls += site->calls;
+            bytes += site->bytes;
+        }
+    }
+
+    qsort(sites, site_count, sizeof(mem_site *), compare_sites);
+
+    fprintf(stderr, "Allocation profile: %lu sites, %lu calls, "
+            "%lu bytes, ranked by %s.\n", (unsigned long) site_count,
+            calls, bytes, profile_by_calls ? "calls" : "bytes");
+    fprintf(stderr, "%10s %12s %12s %12s  %s\n",
+            "calls", "bytes", "peak live", "live", "site");
+
+    for (k = 0; k < site_count; k++)
+    {
+        site = sites[k];
+        fprintf(stderr, "%10lu %12lu %12lu %12lu  %s:%d\n",
+                site->calls, site->bytes, site->peak, site->live,
+                site->filename, site->lineno);
+
+        fprintf(stderr, "%10s sizes:", "");
+        for (b = 0; b < PROFILE_BUCKETS; b++)
+        {
+            if (site->hist[b] == 0)
+            {
+                continue;
+            }
+            if (b < PROFILE_BUCKETS - 1)
+            {
+                fprintf(stderr, " <=%lu:%lu", 1UL << b, site->hist[b]);
+            }
+            else
+            {
+                fprintf(stderr, " >%lu:%lu", 1UL << (b - 1),
+                        site->hist[b]);
+            }
+        }
+        fprintf(stderr, "\n");
+    }
+
+    pthread_mutex_unlock(&site_lock);
+    free(sites);
+}
+
+
+/**********************************************************************
+ *
+ * Functions for the guard zones and the quarantine.
+ *
+ **********************************************************************/
+
+/*
+ * Return 1 if guard zones are on, setting memcheck up first if needed.
+ */
+
+int
+guard_mode(void)
+{
+    pthread_once(&mem_once, memcheck_init);
+    return mem_guarding;
+}
+
+
+/*
+ * Allocate 'size' bytes (zeroed if 'zero' is set, aligned to
+ * 'alignment' if it is more than GUARD_SIZE) between two guard zones,
+ * and record the allocation.  Return the address of the usable memory.
+ */
+
+void *
+guarded_alloc(size_t size, size_t alignment, int zero,
+              char *filename, int lineno)
+{
+    size_t front = (alignment > GUARD_SIZE) ? alignment : GUARD_SIZE;
+    size_t total = front + size + GUARD_SIZE;
+    char *base;
+
+    if (alignment > GUARD_SIZE)
+    {
+        if (posix_memalign((void **)&base, alignment, total) != 0)
+        {
+            base = NULL;
+        }
+        else if (zero)
+        {
+            memset(base + front, 0, size);
+        }
+    }
+    else
+    {
+        base = zero ? (char *)calloc(1, total) : (char *)malloc(total);
+    }
+
+    if (base == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    memset(base, GUARD_BYTE, front);
+    memset(base + front + size, GUARD_BYTE, GUARD_SIZE);
+
+    allocate_mem_node(base + front, size, front, filename, lineno);
+    return base + front;
+}
+
+
+/*
+ * Check the guard zones of a guarded node and, if 'freed' is set, that
+ * its contents still hold FREED_BYTE.  Return a description of the
+ * first problem found, or NULL if there is none.
+ */
+
+char *
+check_mem_node(mem_node *n, int freed)
+{
+    unsigned char *p = (unsigned char *)n->addr;
+    size_t i;
+
+    if (n->front == 0)
+    {
+        return NULL;
+    }
+
+    for (i = 1; i <= GUARD_SIZE; i++)
+    {
+        if (p[-(long)i] != GUARD_BYTE)
+        {
+            return "buffer underrun";
+        }
+    }
+
+    for (i = 0; i < GUARD_SIZE; i++)
+    {
+        if (p[n->nbytes + i] != GUARD_BYTE)
+        {
+            return "buffer overrun";
+        }
+    }
+
+    if (freed)
+    {
+        for (i = 0; i < n->nbytes; i++)
+        {
+            if (p[i] != FREED_BYTE)
+            {
+                return "write to freed memory";
+            }
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Report a problem found by 'check_mem_node'.
+ */
+
+void
+report_mem_error(char *what, mem_node *n)
+{
+    fprintf(stderr, "ERROR: %s at %p: %d bytes allocated in "
+            "file: %s, line: %d", what, n->addr, (int)n->nbytes,
+            n->filename, n->lineno);
+
+    if (n->freed_file != NULL)
+    {
+        fprintf(stderr, ", freed in file: %s, line: %d",
+                n->freed_file, n->freed_line);
+    }
+
+    fprintf(stderr, ".\n");
+}
+
+
+/*
+ * Put a node that has just been marked as freed into the quarantine,
+ * and release the oldest nodes while the quarantine holds too much.
+ * The nodes to release are taken off the queue first, so no index lock
+ * is taken while the quarantine lock is held.
+ */
+
+void
+quarantine_mem_node(mem_node *n)
+{
+    mem_node *old = NULL, *next;
+    char *what;
+
+    memset(n->addr, FREED_BYTE, n->nbytes);
+    n->next = NULL;
+
+    pthread_mutex_lock(&quarantine_lock);
+
+    if (quarantine_tail == NULL)
+    {
+        quarantine_head = n;
+    }
+    else
+    {
+        quarantine_tail->next = n;
+    }
+    quarantine_tail = n;
+    quarantine_bytes += n->nbytes;
+
+    while (quarantine_bytes > QUARANTINE_BYTES)
+    {
+        next = quarantine_head;
+        quarantine_head = next->next;
+        if (quarantine_head == NULL)
+        {
+            quarantine_tail = NULL;
+        }
+        quarantine_bytes -= next->nbytes;
+
+        next->next = old;
+        old = next;
+    }
+
+    pthread_mutex_unlock(&quarantine_lock);
+
+    for (; old != NULL; old = next)
+    {
+        next = old->next;
+
+        if ((what = check_mem_node(old, 1)) != NULL)
+        {
+            report_mem_error(what, old);
+            fprintf(stderr, "Aborting...\n");
+            free_all_mem_nodes();
+            exit(1);
+        }
+
+        release_mem_node(old);
+    }
+}
+
+
+/*
+ * Take a node out of the index, free its block and recycle the node.
+ */
+
+void
+release_mem_node(mem_node *n)
+{
+    mem_shard *s = mem_index_shard(n->addr);
+
+    pthread_mutex_lock(&s->lock);
+    mem_index_remove(s, n);
+    pthread_mutex_unlock(&s->lock);
+
+    free((char *)n->addr - n->front);
+    put_mem_node(n);
+}
+
+
+/**********************************************************************
+ *
+ * Functions for the heap counters.
+ *
+ **********************************************************************/
+
+/*
+ * Count an allocation of 'nbytes' bytes, and raise the high-water mark
+ * if the live bytes went past it.
+ */
+
+void
+count_alloc(size_t nbytes)
+{
+    unsigned long live, peak;
+
+    __sync_fetch_and_add(&mem_total_allocs, 1);
+    live = __sync_add_and_fetch(&mem_live_bytes, nbytes);
+
+    while (live > (peak = __sync_fetch_and_add(&mem_peak_bytes, 0))
+           && !__sync_bool_compare_and_swap(&mem_peak_bytes, peak, live))
+    {
+        ;
+    }
+}
+
+
+/*
+ * Count a free of 'nbytes' bytes.
+ */
+
+void
+count_free(size_t nbytes)
+{
+    __sync_fetch_and_add(&mem_total_frees, 1);
+    __sync_fetch_and_sub(&mem_live_bytes, nbytes);
+}
+
+
+/**********************************************************************
+ *
+ * Low-level functions for managing the memory nodes.
+ *
+ **********************************************************************/
+
+/*
+ * Allocate a memory node, set its values and add it to the index.
+ */
+
+void
+allocate_mem_node(void *addr, size_t nbytes, size_t front,
+                  char *filename, int lineno)
+{
+    mem_node *n;
+    mem_shard *s;
+
+    /* Take a node from this thread's free list and set its fields. */
+    n = get_mem_node();
+
+#if DEBUG == 1
+    fprintf(stderr, "Allocating %d bytes of memory at %p\n",
+            nbytes, addr);
+#endif
+
+    /*
+     * The filename comes from __FILE__ in the memcheck.h macros, so it is
+     * a string literal that lives as long as the program, and only the
+     * pointer needs to be kept.
+     */
+    n->addr     = addr;
+    n->nbytes   = nbytes;
+    n->filename = filename;
+    n->lineno   = lineno;
+    n->seq      = __sync_fetch_and_add(&mem_sequence, 1);
+    n->site     = NULL;
+    n->front    = front;
+    n->freed_file = NULL;
+    n->freed_line = 0;
+
+    count_alloc(nbytes);
+
+    s = mem_index_shard(addr);
+
+    if (mem_profiling)
+    {
+        profile_alloc(n);
+
+        if (profile_requested)
+        {
+            profile_requested = 0;
+            print_allocation_profile();
+        }
+    }
+
+    pthread_mutex_lock(&s->lock);
+    mem_index_insert(s, n);
+    pthread_mutex_unlock(&s->lock);
+}
+
+
+/*
+ * Free the memory of a node that has been removed from the index, and
+ * put the node back on the free list.
+ */
+
+void
+free_mem_node(mem_node *n)
+{
+    if (n != NULL)
+    {
+        if (n->addr == NULL)
+        {
+            fprintf(stderr, "ERROR: invalid node at: %p\n", n->addr);
+            return;
+        }
+
+#if DEBUG == 1
+        fprintf(stderr, "Freeing memory at %p\n", n->addr);
+#endif
+
+        if (n->site != NULL)
+        {
+            profile_free(n);
+        }
+
+        count_free(n->nbytes);
+        free((char *)n->addr - n->front);
+        put_mem_node(n);
+    }
+}
+
+
+/*
+ * Free the memory of every node in the index, then the index and the
+ * slabs themselves.
+ */
+
+void
+free_all_mem_nodes(void)
+{
+    mem_shard *s;
+    size_t i;
+    int j;
+
+    pthread_once(&mem_once, memcheck_init);
+
+    for (j = 0; j < MEM_SHARDS; j++)
+    {
+        s = &mem_shards[j];
+        pthread_mutex_lock(&s->lock);
+
+        for (i = 0; i < s->size; i++)
+        {
+            if (s->slots[i] != NULL)
+            {
+                free((char *)s->slots[i]->addr - s->slots[i]->front);
+            }
+        }
+
+        free(s->slots);
+        s->slots = NULL;
+        s->size  = 0;
+        s->count = 0;
+
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    /* Every node is gone, so the quarantine and the slabs go too. */
+    pthread_mutex_lock(&quarantine_lock);
+    quarantine_head  = NULL;
+    quarantine_tail  = NULL;
+    quarantine_bytes = 0;
+    pthread_mutex_unlock(&quarantine_lock);
+
+    mem_live_bytes  = 0;
+    mem_total_frees = mem_total_allocs;
+
+    free_node_slabs();
+}
+
+
+/*
+ * Return the node of shard 's' that corresponds to the address 'addr',
+ * or NULL if the address isn't found.
+ */
+
+mem_node *
+find_node(mem_shard *s, void *addr)
+{
+    size_t i;
+
+    if (s->size == 0)
+    {
+        return NULL;
+    }
+
+    for (i = mem_index_home(s, addr); s->slots[i] != NULL;
+         i = (i + 1) & (s->size - 1))
+    {
+        if (s->slots[i]->addr == addr)
+        {
+            return s->slots[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Order memory nodes newest first.
+ */
+
+int
+compare_mem_nodes(const void *a, const void *b)
+{
+    unsigned long seq_a = (*(mem_node * const *)a)->seq;
+    unsigned long seq_b = (*(mem_node * const *)b)->seq;
+
+    return (seq_a < seq_b) - (seq_a > seq_b);
+}
+
+
+/*
+ * A debugging function to print the contents of the memory nodes in
+ * the index, shard by shard.
+ */
+
+void
+dump_pool(void)
+{
+    mem_shard *s;
+    mem_node *n;
+    size_t i;
+    int j;
+
+    pthread_once(&mem_once, memcheck_init);
+
+    for (j = 0; j < MEM_SHARDS; j++)
+    {
+        s = &mem_shards[j];
+        pthread_mutex_lock(&s->lock);
+
+        for (i = 0; i < s->size; i++)
+        {
+            if ((n = s->slots[i]) == NULL)
+            {
+                continue;
+            }
+
+            fprintf(stderr, "NODE --------\n");
+            fprintf(stderr, "location: %p\n", (void *)n);
+            fprintf(stderr, "addr: %p\n", n->addr);
+            fprintf(stderr, "nbytes: %d\n", (int)n->nbytes);
+            fprintf(stderr, "filename: %s\n", n->filename);
+            fprintf(stderr, "line number: %d\n", n->lineno);
+            fprintf(stderr, "sequence: %lu\n", n->seq);
+            if (n->freed_file != NULL)
+            {
+                fprintf(stderr, "freed in: %s, line %d\n",
+                        n->freed_file, n->freed_line);
+            }
+            fprintf(stderr, "\n");
+        }
+
+        pthread_mutex_unlock(&s->lock);
+    }
+}
+
+
+/**********************************************************************
+ *
+ * User-level functions.
+ *
+ * NOTE: Normally, the user will not use these functions, but will
+ *       use 'malloc' and 'calloc' wrappers defined in "memcheck.h".
+ *
+ **********************************************************************/
+
+
+/*
+ * Allocate 'size' bytes of memory.  Also add the address, filename, and line
+ * number as a new node in the index of memory nodes.
+ */
+
+void *
+checked_malloc_fn(size_t size, char *filename, int lineno)
+{
+    void *mem;
+
+    if (guard_mode())
+    {
+        return guarded_alloc(size, 0, 0, filename, lineno);
+    }
+
+    mem = malloc(size);
+
+    if (mem == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    allocate_mem_node(mem, size, 0, filename, lineno);
+    return mem;
+}
+
+
+/*
+ * This function is the same as 'checked_malloc' except that it has
+ * a different signature (corresponding to 'calloc' in the first two
+ * arguments) and zeroes out all the allocated memory.
+ */
+
+void *
+checked_calloc_fn(size_t nmemb, size_t size, char *filename, int lineno)
+{
+    void *mem;
+
+    /*
+     * 'calloc' checks that 'nmemb * size' fits in a size_t, but the
+     * guarded block is sized here, so it has to be checked first;
+     * (size_t) -1 is SIZE_MAX, which -ansi does not have.
+     */
+    if (size != 0 && nmemb > (size_t) -1 / size)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    if (guard_mode())
+    {
+        return guarded_alloc(nmemb * size, 0, 1, filename, lineno);
+    }
+
+    mem = calloc(nmemb, size);
+
+    if (mem == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    allocate_mem_node(mem, (nmemb * size), 0, filename, lineno);
+    return mem;
+}
+
+
+/*
+ * Resize memory allocated by one of the checked functions, like
+ * 'realloc'.  The node is taken out of the index under its shard's lock
+ * before 'realloc' runs, since once the old block is freed another
+ * thread may be given its address; the node goes back in at the new
+ * address, which may be the old one, with the new size and this call
+ * site.  A NULL pointer allocates and a size of zero frees, as with
+ * 'realloc'.
+ */
+
+void *
+checked_realloc_fn(void *ptr, size_t size, char *filename, int lineno)
+{
+    mem_shard *s, *new_s;
+    mem_node *n;
+    size_t old_nbytes = 0;
+    void *mem;
+
+    if (ptr == NULL)
+    {
+        return checked_malloc_fn(size, filename, lineno);
+    }
+
+    if (size == 0)
+    {
+        checked_free_fn(ptr, filename, lineno);
+        return NULL;
+    }
+
+    /*
+     * Guarded nodes stay in the index, since the old block is freed
+     * through 'checked_free_fn' below, which finds them there.
+     */
+    s = mem_index_shard(ptr);
+    pthread_mutex_lock(&s->lock);
+    n = find_node(s, ptr);
+    if (n != NULL && n->freed_file == NULL)
+    {
+        old_nbytes = n->nbytes;
+        if (n->front == 0)
+        {
+            mem_index_remove(s, n);
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    if (n == NULL || n->freed_file != NULL)
+    {
+        fprintf(stderr,
+                "ERROR: invalid attempt to reallocate unallocated memory "
+                "at %p in file: %s, line: %d\n", ptr, filename, lineno);
+        fprintf(stderr, "Aborting...\n");
+        free_all_mem_nodes();
+        exit(1);
+    }
+
+    if (n->front != 0)
+    {
+        /* The guard zones have to move, so always copy. */
+        mem = guarded_alloc(size, 0, 0, filename, lineno);
+        memcpy(mem, ptr, (old_nbytes < size) ? old_nbytes : size);
+        checked_free_fn(ptr, filename, lineno);
+        return mem;
+    }
+
+    mem = realloc(ptr, size);
+
+    if (mem == NULL)
+    {
+        /* The old block is still there, so its node goes back. */
+        pthread_mutex_lock(&s->lock);
+        mem_index_insert(s, n);
+        pthread_mutex_unlock(&s->lock);
+
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    if (n->site != NULL)
+    {
+        profile_free(n);
+    }
+
+    /* Counted as a free of the old size and an allocation of the new. */
+    count_free(old_nbytes);
+    count_alloc(size);
+
+    /* No other thread can see the node until it is back in the index. */
+    n->addr     = mem;
+    n->nbytes   = size;
+    n->filename = filename;
+    n->lineno   = lineno;
+
+    if (n->site != NULL)
+    {
+        profile_alloc(n);
+    }
+
+    new_s = mem_index_shard(mem);
+    pthread_mutex_lock(&new_s->lock);
+    mem_index_insert(new_s, n);
+    pthread_mutex_unlock(&new_s->lock);
+
+    return mem;
+}
+
+
+/*
+ * Make a checked copy of the string 's', like 'strdup'.
+ */
+
+char *
+checked_strdup_fn(const char *s, char *filename, int lineno)
+{
+    size_t len = strlen(s) + 1;
+    char *copy;
+
+    copy = (char *)checked_malloc_fn(len, filename, lineno);
+    memcpy(copy, s, len);
+    return copy;
+}
+
+
+/*
+ * Allocate 'size' bytes aligned to 'alignment' bytes, like C11's
+ * 'aligned_alloc'.  Alignments smaller than a pointer are rounded up,
+ * since 'posix_memalign' does the work.  An alignment that is not a
+ * power of two is an error.
+ */
+
+void *
+checked_aligned_alloc_fn(size_t alignment, size_t size,
+                         char *filename, int lineno)
+{
+    void *mem;
+
+    if (alignment < sizeof(void *))
+    {
+        alignment = sizeof(void *);
+    }
+
+    if (checked_posix_memalign_fn(&mem, alignment, size,
+                                  filename, lineno) != 0)
+    {
+        fprintf(stderr,
+                "ERROR: invalid alignment %lu in file: %s, line: %d\n",
+                (unsigned long)alignment, filename, lineno);
+        fprintf(stderr, "Aborting...\n");
+        free_all_mem_nodes();
+        exit(1);
+    }
+
+    return mem;
+}
+
+
+/*
+ * Like 'posix_memalign': store 'size' bytes aligned to 'alignment' in
+ * '*memptr' and return 0, or return EINVAL if the alignment is not a
+ * power of two multiple of the size of a pointer.  Running out of
+ * memory aborts, as in the other checked functions.
+ */
+
+int
+checked_posix_memalign_fn(void **memptr, size_t alignment, size_t size,
+                          char *filename, int lineno)
+{
+    void *mem;
+    int result;
+
+    if (guard_mode())
+    {
+        if (alignment % sizeof(void *) != 0
+            || (alignment & (alignment - 1)) != 0)
+        {
+            return EINVAL;
+        }
+
+        *memptr = guarded_alloc(size, alignment, 0, filename, lineno);
+        return 0;
+    }
+
+    result = posix_memalign(&mem, alignment, size);
+
+    if (result == EINVAL)
+    {
+        return result;
+    }
+
+    if (result != 0)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    allocate_mem_node(mem, size, 0, filename, lineno);
+    *memptr = mem;
+    return 0;
+}
+
+
+/*
+ * Free a pointer that was previously allocated by 'checked_malloc()'.  If
+ * the memory being freed is not found in the index, print an error
+ * message and abort.
+ */
+
+void
+checked_free_fn(void *ptr, char *filename, int lineno)
+{
+    mem_shard *s = mem_index_shard(ptr);
+    mem_node *n;
+    char *freed_file = NULL;
+    int freed_line = 0;
+    char *what;
+
+    /*
+     * Guarded nodes stay in the index while in the quarantine; marking
+     * them under the lock means only one of two racing frees wins.
+     */
+    pthread_mutex_lock(&s->lock);
+    n = find_node(s, ptr);
+    if (n != NULL && (freed_file = n->freed_file) != NULL)
+    {
+        freed_line = n->freed_line;
+    }
+    else if (n != NULL && n->front != 0)
+    {
+        n->freed_file = filename;
+        n->freed_line = lineno;
+    }
+    else if (n != NULL)
+    {
+        mem_index_remove(s, n);
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    if (n == NULL)
+    {
+        fprintf(stderr,
+                "ERROR: invalid attempt to free unallocated memory at %p "
+                "in file: %s, line: %d\n", ptr, filename, lineno);
+        fprintf(stderr, "Aborting...\n");
+        free_all_mem_nodes();
+        exit(1);
+    }
+    else if (freed_file != NULL)
+    {
+        fprintf(stderr,
+                "ERROR: double free of memory at %p in file: %s, "
+                "line: %d, already freed in file: %s, line: %d\n",
+                ptr, filename, lineno, freed_file, freed_line);
+        fprintf(stderr, "Aborting...\n");
+        free_all_mem_nodes();
+        exit(1);
+    }
+    else if (n->front != 0)
+    {
+        if ((what = check_mem_node(n, 0)) != NULL)
+        {
+            report_mem_error(what, n);
+            fprintf(stderr, "Aborting...\n");
+            free_all_mem_nodes();
+            exit(1);
+        }
+
+        if (n->site != NULL)
+        {
+            profile_free(n);
+        }
+
+        count_free(n->nbytes);
+        quarantine_mem_node(n);
+    }
+    else
+    {
+        free_mem_node(n);
+    }
+}
+
+
+/*
+ * This function is intended to be called at the end of a program only.
+ * It goes through the memory nodes of all threads, newest first, and prints
+ * out information on the contents of each node.  Any nodes that exist at
+ * the end of the program represent leaked memory.  With guard zones on,
+ * every block, freed or not, is checked first.
+ */
+
+void
+print_memory_leaks(void)
+{
+    mem_node **leaks;
+    mem_node *n;
+    mem_shard *s;
+    size_t count, i, k;
+    char *what;
+    int j;
+
+    pthread_once(&mem_once, memcheck_init);
+
+    /* Gather the nodes of every shard, so they can be sorted. */
+    for (j = 0; j < MEM_SHARDS; j++)
+    {
+        pthread_mutex_lock(&mem_shards[j].lock);
+    }
+
+    count = 0;
+    for (j = 0; j < MEM_SHARDS; j++)
+    {
+        count += mem_shards[j].count;
+    }
+
+    leaks = (mem_node **)malloc((count + 1) * sizeof(mem_node *));
+
+    if (leaks == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    k = 0;
+    for (j = 0; j < MEM_SHARDS; j++)
+    {
+        s = &mem_shards[j];
+        for (i = 0; i < s->size; i++)
+        {
+            if ((n = s->slots[i]) == NULL)
+            {
+                continue;
+            }
+
+            /* Check guarded nodes; only those not freed are leaks. */
+            if ((what = check_mem_node(n, n->freed_file != NULL)) != NULL)
+            {
+                report_mem_error(what, n);
+            }
+            if (n->freed_file == NULL)
+            {
+                leaks[k++] = n;
+            }
+        }
+    }
+    count = k;
+
+    for (j = MEM_SHARDS - 1; j >= 0; j--)
+    {
+        pthread_mutex_unlock(&mem_shards[j].lock);
+    }
+
+    qsort(leaks, count, sizeof(mem_node *), compare_mem_nodes);
+
+    for (k = 0; k < count; k++)
+    {
+        fprintf(stderr,
+                "Memory leak: %d bytes allocated at %p in "
+                "file: %s, line: %d.\n",
+                (int)leaks[k]->nbytes, leaks[k]->addr,
+                leaks[k]->filename, leaks[k]->lineno);
+    }
+
+    free(leaks);
+    free_all_mem_nodes();
+}
+
+
+/**********************************************************************
+ *
+ * Live heap statistics and snapshots.  Unlike 'print_memory_leaks',
+ * these can be used while the program runs; they free nothing.
+ *
+ **********************************************************************/
+
+/*
+ * Fill in the current heap counters.  This takes constant time.
+ */
+
+void
+get_memcheck_stats(memcheck_stats *stats)
+{
+    stats->allocs      = mem_total_allocs;
+    stats->frees       = mem_total_frees;
+    stats->live_bytes  = mem_live_bytes;
+    stats->live_blocks = stats->allocs - stats->frees;
+    stats->peak_bytes  = mem_peak_bytes;
+
+    pthread_mutex_lock(&slab_lock);
+    stats->node_bytes  = mem_node_slabs * sizeof(node_slab);
+    pthread_mutex_unlock(&slab_lock);
+}
+
+
+/*
+ * Print the current heap counters to stderr.
+ */
+
+void
+print_memcheck_stats(void)
+{
+    memcheck_stats stats;
+
+    get_memcheck_stats(&stats);
+    fprintf(stderr, "Heap: %lu bytes live in %lu blocks, peak %lu bytes, "
+            "%lu allocations, %lu frees.\n", stats.live_bytes,
+            stats.live_blocks, stats.peak_bytes, stats.allocs,
+            stats.frees);
+}
+
+
+/*
+ * Order site totals by file name pointer, then line.
+ */
+
+int
+compare_site_totals(const void *a, const void *b)
+{
+    const site_total *sa = (const site_total *)a;
+    const site_total *sb = (const site_total *)b;
+    unsigned long fa = (unsigned long)sa->filename;
+    unsigned long fb = (unsigned long)sb->filename;
+
+    if (fa != fb)
+    {
+        return (fa > fb) - (fa < fb);
+    }
+    return (sa->lineno > sb->lineno) - (sa->lineno < sb->lineno);
+}
+
+
+/*
+ * Return a snapshot of the live memory by call site.  The shards are
+ * walked one at a time, so other threads are held up only briefly.
+ * The caller frees it with 'free_memcheck_snapshot'.
+ */
+
+memcheck_snapshot *
+take_memcheck_snapshot(void)
+{
+    memcheck_snapshot *snap;
+    site_total *sites, *more;
+    mem_shard *s;
+    mem_node *n;
+    size_t count, cap, i, k;
+    int j;
+
+    pthread_once(&mem_once, memcheck_init);
+
+    snap = (memcheck_snapshot *)malloc(sizeof(memcheck_snapshot));
+    cap = 64;
+    sites = (site_total *)malloc(cap * sizeof(site_total));
+
+    if (snap == NULL || sites == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    get_memcheck_stats(&snap->stats);
+
+    /* One entry per live block first. */
+    count = 0;
+    for (j = 0; j < MEM_SHARDS; j++)
+    {
+        s = &mem_shards[j];
+        pthread_mutex_lock(&s->lock);
+
+        if (count + s->count > cap)
+        {
+            while (count + s->count > cap)
+            {
+                cap *= 2;
+            }
+            more = (site_total *)realloc(sites, cap * sizeof(site_total));
+
+            if (more == NULL)
+            {
+                fprintf(stderr, "ERROR: memory allocation failed!  "
+                                "Aborting...\n");
+                exit(1);
+            }
+            sites = more;
+        }
+
+        for (i = 0; i < s->size; i++)
+        {
+            if ((n = s->slots[i]) != NULL && n->freed_file == NULL)
+            {
+                sites[count].filename = n->filename;
+                sites[count].lineno   = n->lineno;
+                sites[count].bytes    = n->nbytes;
+                sites[count].blocks   = 1;
+                count++;
+            }
+        }
+
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    /* Then sort them and add up the entries of each site. */
+    qsort(sites, count, sizeof(site_total), compare_site_totals);
+
+    for (i = k = 0; i < count; i++)
+    {
+        if (k > 0 && compare_site_totals(&sites[k - 1], &sites[i]) == 0)
+        {
+            sites[k - 1].bytes  += sites[i].bytes;
+            sites[k - 1].blocks += sites[i].blocks;
+        }
+        else
+        {
+            sites[k++] = sites[i];
+        }
+    }
+
+    snap->sites  = sites;
+    snap->nsites = k;
+    return snap;
+}
+
+
+void
+free_memcheck_snapshot(memcheck_snapshot *snap)
+{
+    if (snap != NULL)
+    {
+        free(snap->sites);
+        free(snap);
+    }
+}
+
+
+/*
+ * Order site changes by growth in bytes, largest first.
+ */
+
+int
+compare_site_changes(const void *a, const void *b)
+{
+    long ba = ((const site_change *)a)->bytes;
+    long bb = ((const site_change *)b)->bytes;
+
+    return (ba < bb) - (ba > bb);
+}
+
+
+/*
+ * Print to stderr how the live memory changed between two snapshots,
+ * overall and for each call site whose live memory changed, sites that
+ * grew the most first.
+ */
+
+void
+print_memcheck_snapshot_diff(memcheck_snapshot *before,
+                             memcheck_snapshot *after)
+{
+    site_change *changes;
+    site_total empty;
+    site_total *a, *b;
+    size_t i, j, k;
+    int order;
+
+    changes = (site_change *)malloc((before->nsites + after->nsites + 1)
+                                    * sizeof(site_change));
+
+    if (changes == NULL)
+    {
+        fprintf(stderr, "ERROR: memory allocation failed!  Aborting...\n");
+        exit(1);
+    }
+
+    empty.bytes  = 0;
+    empty.blocks = 0;
+
+    /* Merge the two sorted lists of sites. */
+    i = j = k = 0;
+    while (i < before->nsites || j < after->nsites)
+    {
+        if (i == before->nsites)
+        {
+            order = 1;
+        }
+        else if (j == after->nsites)
+        {
+            order = -1;
+        }
+        else
+        {
+            order = compare_site_totals(&before->sites[i],
+                                        &after->sites[j]);
+        }
+
+        a = (order <= 0) ? &before->sites[i++] : &empty;
+        b = (order >= 0) ? &after->sites[j++] : &empty;
+
+        if (a->bytes != b->bytes || a->blocks != b->blocks)
+        {
+            changes[k].site   = (b != &empty) ? b : a;
+            changes[k].bytes  = (long)b->bytes - (long)a->bytes;
+            changes[k].blocks = (long)b->blocks - (long)a->blocks;
+            k++;
+        }
+    }
+
+    qsort(changes, k, sizeof(site_change), compare_site_changes);
+
+    fprintf(stderr, "Heap change: %+ld bytes, %+ld blocks, "
+            "peak %lu bytes.\n",
+            (long)after->stats.live_bytes - (long)before->stats.live_bytes,
+            (long)after->stats.live_blocks
+            - (long)before->stats.live_blocks,
+            after->stats.peak_bytes);
+
+    for (i = 0; i < k; i++)
+    {
+        fprintf(stderr, "%+12ld bytes %+8ld blocks  %s:%d\n",
+                changes[i].bytes, changes[i].blocks,
+                changes[i].site->filename, changes[i].site->lineno);
+    }
+
+    free(changes);
+}
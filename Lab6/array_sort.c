@@ -0,0 +1,348 @@
+/*
+ * FILE: array_sort.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memcheck.h"
+#include "array_sort.h"
+
+/* The number of digits in a number, and the bit that flips its sign. */
+#define RADIX_DIGITS ((32 + RADIX_BITS - 1) / RADIX_BITS)
+#define SIGN_BIT 0x80000000UL
+
+
+void introsort_range(int *a, long lo, long hi, int depth);
+void sift_down(int *a, long root, long n);
+
+
+/*
+ * introsort:
+ *     Sort 'n' numbers in place.  The recursion depth of the quicksort
+ *     is limited to about twice log2 of 'n'; a partition that would go
+ *     deeper has met many bad pivots, and is heapsorted instead, so the
+ *     sort never takes quadratic time.
+ */
+
+void
+introsort(int *a, long n)
+{
+    int depth = 0;
+    long m;
+
+    for (m = n; m > 1; m /= 2)
+    {
+        depth += 2;
+    }
+
+    introsort_range(a, 0, n, depth);
+}
+
+
+/*
+ * introsort_range:
+ *     Sort the numbers from a[lo] up to, but not including, a[hi].  Only
+ *     the shorter side of each partition is sorted recursively; the loop
+ *     carries on with the longer one, so the stack stays small.
+ */
+
+void
+introsort_range(int *a, long lo, long hi, int depth)
+{
+    long i, j, mid;
+    int pivot;
+    int t;
+
+    while (hi - lo > INSERTION_SORT_THRESHOLD)
+    {
+        if (depth == 0)
+        {
+            heapsort_ints(a + lo, hi - lo);
+            return;
+        }
+        depth--;
+
+        /*
+         * Sort the first, middle and last numbers and take the middle
+         * one as the pivot.  The first is then no larger than the pivot
+         * and the last no smaller, so the scans below need no bounds
+         * checks.
+         */
+        mid = lo + (hi - lo) / 2;
+        if (a[mid] < a[lo])
+        {
+            t = a[mid]; a[mid] = a[lo]; a[lo] = t;
+        }
+        if (a[hi - 1] < a[mid])
+        {
+            t = a[hi - 1]; a[hi - 1] = a[mid]; a[mid] = t;
+            if (a[mid] < a[lo])
+            {
+                t = a[mid]; a[mid] = a[lo]; a[lo] = t;
+            }
+        }
+        pivot = a[mid];
+
+        /*
+         * Swap numbers until those before a[i] are no larger than the
+         * pivot and those from a[i] on are no smaller.  Numbers equal to
+         * the pivot stop both scans, so they end up on both sides, which
+         * keeps the partitions even when there are many of them.
+         */
+        i = lo;
+        j = hi - 1;
+        for (;;)
+        {
+            while (a[++i] < pivot)
+                ;
+            while (pivot < a[--j])
+                ;
+            if (i >= j)
+            {
+                break;
+            }
+            t = a[i]; a[i] = a[j]; a[j] = t;
+        }
+
+        if (i - lo < hi - i)
+        {
+            introsort_range(a, lo, i, depth);
+            lo = i;
+        }
+        else
+        {
+            introsort_range(a, i, hi, depth);
+            hi = i;
+        }
+    }
+
+    insertion_sort_ints(a + lo, hi - lo);
+}
+
+
+/*
+ * radix_sort_ints:
+ *     Sort 'n' numbers in place with a radix sort, or with the introsort
+ *     if there are few of them or no memory for the buffer.
+ */
+
+void
+radix_sort_ints(int *a, long n)
+{
+    int *buffer;
+
+    if (n < RADIX_SORT_THRESHOLD)
+    {
+        introsort(a, n);
+        return;
+    }
+
+    buffer = (int *)malloc(n * sizeof(int));
+    if (buffer == NULL)
+    {
+        introsort(a, n);
+        return;
+    }
+
+    radix_sort_with_buffer(a, buffer, n);
+    free(buffer);
+}
+
+
+/*
+ * radix_sort_with_buffer:
+ *     Sort 'n' numbers in place, one digit at a time from the lowest.
+ *     Each pass counts how many numbers have each digit, and so where
+ *     each digit starts, then moves every number to the buffer in that
+ *     order; the pass after moves them back.  Moving keeps equal digits
+ *     in their order, so the result is sorted on all digits.
+ *
+ *     Flipping the sign bit of each number makes negative numbers sort
+ *     before positive ones as unsigned.  The counts for all the digits
+ *     are made in one pass over the numbers, and a digit that is the
+ *     same in every number is skipped, which saves passes when the
+ *     numbers are small.
+ */
+
+void
+radix_sort_with_buffer(int *a, int *buffer, long n)
+{
+    long count[RADIX_DIGITS][RADIX_BUCKETS];
+    unsigned long key;
+    int *from, *to, *t;
+    long i, sum, c;
+    int d, shift, digit;
+
+    if (n < 2)
+    {
+        return;
+    }
+
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < n; i++)
+    {
+        key = ((unsigned long)a[i] ^ SIGN_BIT) & 0xffffffffUL;
+        for (d = 0; d < RADIX_DIGITS; d++)
+        {
+            count[d][(key >> (d * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+        }
+    }
+
+    from = a;
+    to = buffer;
+    for (d = 0; d < RADIX_DIGITS; d++)
+    {
+        shift = d * RADIX_BITS;
+
+        /* Skip the digit if every number has the same one. */
+        digit = (int)((((unsigned long)from[0] ^ SIGN_BIT) >> shift)
+                      & (RADIX_BUCKETS - 1));
+        if (count[d][digit] == n)
+        {
+            continue;
+        }
+
+        /* Turn the counts into the index of the first of each digit. */
+        sum = 0;
+        for (digit = 0; digit < RADIX_BUCKETS; digit++)
+        {
+            c = count[d][digit];
+            count[d][digit] = sum;
+            sum += c;
+        }
+
+        for (i = 0; i < n; i++)
+        {
+            key = ((unsigned long)from[i] ^ SIGN_BIT) & 0xffffffffUL;
+            to[count[d][(key >> shift) & (RADIX_BUCKETS - 1)]++] = from[i];
+        }
+
+        t = from;
+        from = to;
+        to = t;
+    }
+
+    /* After an odd number of passes the numbers are in the buffer. */
+    if (from != a)
+    {
+        memcpy(a, from, n * sizeof(int));
+    }
+}
+
+
+/*
+ * sift_down:
+ *     Move a[root] down the heap of the first 'n' numbers of 'a' until
+ *     it is no smaller than its children.
+ */
+
+void
+sift_down(int *a, long root, long n)
+{
+    long child;
+    int value = a[root];
+
+    while ((child = 2 * root + 1) < n)
+    {
+        if (child + 1 < n && a[child] < a[child + 1])
+        {
+            child++;
+        }
+        if (a[child] <= value)
+        {
+            break;
+        }
+        a[root] = a[child];
+        root = child;
+    }
+
+    a[root] = value;
+}
+
+
+/*
+ * heapsort_ints:
+ *     Sort 'n' numbers in place by making them into a max-heap, then
+ *     moving the largest number to the end of the heap until it is empty.
+ */
+
+void
+heapsort_ints(int *a, long n)
+{
+    long i;
+    int t;
+
+    for (i = n / 2 - 1; i >= 0; i--)
+    {
+        sift_down(a, i, n);
+    }
+
+    for (i = n - 1; i > 0; i--)
+    {
+        t = a[0]; a[0] = a[i]; a[i] = t;
+        sift_down(a, 0, i);
+    }
+}
+
+
+/*
+ * insertion_sort_ints:
+ *     Sort 'n' numbers in place by inserting each number into the sorted
+ *     numbers before it.  Fast for short or nearly sorted arrays.
+ */
+
+void
+insertion_sort_ints(int *a, long n)
+{
+    long i, j;
+    int value;
+
+    for (i = 1; i < n; i++)
+    {
+        value = a[i];
+        for (j = i; j > 0 && a[j - 1] > value; j--)
+        {
+            a[j] = a[j - 1];
+        }
+        a[j] = value;
+    }
+}
+
+
+/*
+ * Print 'n' numbers, one per line.
+ */
+
+void
+print_ints(int *a, long n)
+{
+    long i;
+
+    for (i = 0; i < n; i++)
+    {
+        printf("%d\n", a[i]);
+    }
+}
+
+
+/*
+ * Return 1 if 'n' numbers are sorted, otherwise 0.
+ * Useful for debugging.
+ */
+
+int
+ints_sorted(int *a, long n)
+{
+    long i;
+
+    for (i = 1; i < n; i++)
+    {
+        if (a[i - 1] > a[i])  /* wrong order */
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
@@ -0,0 +1,63 @@
+/*
+ * FILE: array_sort.h
+ */
+
+#ifndef ARRAY_SORT_H
+#define ARRAY_SORT_H
+
+
+/*
+ * Sorting of plain arrays of numbers.  The numbers of an array sit next
+ * to each other in memory, so sorting them reads whole cache lines and
+ * follows no pointers, which makes it much faster than sorting a list.
+ */
+
+/* Partitions shorter than this are finished with an insertion sort. */
+#define INSERTION_SORT_THRESHOLD 16
+
+/*
+ * Arrays shorter than this are radix sorted with 'introsort' instead;
+ * 'bench_sort' shows where the radix sort starts to win.
+ */
+#define RADIX_SORT_THRESHOLD 256
+
+/* The radix sort sorts on digits of this many bits, lowest first. */
+#define RADIX_BITS 11
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+
+/*
+ * Sort 'n' numbers in place with an introsort: a quicksort with a
+ * median-of-three pivot, which switches to a heapsort when it recurses
+ * too deeply and to an insertion sort on short partitions.  O(N log N)
+ * in the worst case, and it uses no extra memory.
+ */
+void introsort(int *a, long n);
+
+/*
+ * Sort 'n' numbers in place with an LSD radix sort, which compares no
+ * numbers but moves them all once per digit of RADIX_BITS bits, so it
+ * takes O(N) time.  Uses a buffer as large as the array; if that cannot be had,
+ * this is just 'introsort'.
+ */
+void radix_sort_ints(int *a, long n);
+
+/*
+ * Like 'radix_sort_ints', but use 'buffer', which must hold 'n' numbers,
+ * and radix sort even short arrays.
+ */
+void radix_sort_with_buffer(int *a, int *buffer, long n);
+
+/* Sort 'n' numbers in place with a heapsort. */
+void heapsort_ints(int *a, long n);
+
+/* Sort 'n' numbers in place with an insertion sort. */
+void insertion_sort_ints(int *a, long n);
+
+/* Print 'n' numbers, one per line, like 'print_list'. */
+void print_ints(int *a, long n);
+
+/* Return 1 if 'n' numbers are sorted, otherwise 0. */
+int ints_sorted(int *a, long n);
+
+#endif  /* ARRAY_SORT_H */
@@ -0,0 +1,564 @@
+/*
+ * FILE: bench_lists.c
+ *     Benchmark of the plain linked list against the unrolled list.
+ *     Each list of random numbers is built, walked, copied, reversed,
+ *     sorted, checked and freed, and the time per element of each step
+ *     is printed for each representation: a plain list of nodes from
+ *     malloc, a plain list of nodes from a node pool, and an unrolled
+ *     list.  The plain lists are sorted by relinking their nodes, while
+ *     the unrolled list copies its numbers to an array, sorts that and
+ *     copies them back.  Small lists are run many times and the fastest
+ *     run is kept.  Every representation and size is run in its own
+ *     child process, so that no run inherits a heap fragmented by the
+ *     one before.  The copy, the reversal and the sort of every run are
+ *     checked against the numbers, outside the timed steps.
+ */
+
+/* Needed for clock_gettime, fork and pipe under -ansi. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "memcheck.h"
+#include "linked_list.h"
+#include "unrolled_list.h"
+
+#define MAX_SIZES 16
+
+/* Lists shorter than this are run several times. */
+#define REPEAT_ELEMENTS 1000000L
+
+#define NSTEPS 7
+
+/* The representations. */
+#define PLAIN 0
+#define POOL 1
+#define UNROLLED 2
+#define NREPS 3
+
+
+/*
+ * The time in nanoseconds of each step of a run.
+ */
+
+typedef struct
+{
+    double step[NSTEPS];
+} run_times;
+
+char *step_names[NSTEPS] =
+{
+    "build", "walk", "copy", "reverse", "sort*", "is_sorted", "free"
+};
+
+char *rep_names[NREPS] = { "list", "pool", "unrolled" };
+
+
+void usage(char *progname);
+unsigned long next_random(void);
+double now_ns(void);
+int compare_ints(const void *a, const void *b);
+void wrong_list(char *kind, long n, char *step);
+void check_list(node *list, int *expect, long n, int backwards,
+                char *step);
+void check_unrolled(unrolled_list *list, int *expect, long n,
+                    int backwards, char *step);
+void run_plain(int *values, int *sorted, long n, run_times *t);
+void run_pool(int *values, int *sorted, long n, run_times *t);
+void run_unrolled(int *values, int *sorted, long n, run_times *t);
+void keep_fastest(run_times *best, run_times *t);
+int time_runs(int rep, int *values, int *sorted, long n, long reps,
+              run_times *best);
+
+
+unsigned long random_state = 2463534242UL;
+
+/* Results of the walks, so they are not optimized away. */
+volatile long sink;
+
+
+void usage(char *progname)
+{
+    fprintf(stderr, "usage: %s [-n elements]... [-s seed]\n", progname);
+}
+
+
+/* 32-bit xorshift random number generator. */
+unsigned long next_random(void)
+{
+    random_state ^= (random_state << 13) & 0xffffffffUL;
+    random_state ^= random_state >> 17;
+    random_state ^= (random_state << 5) & 0xffffffffUL;
+    return random_state;
+}
+
+
+/* Current time in nanoseconds. */
+double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/* Comparison function for `qsort`: increasing order. */
+int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/* Exit with an error about a list of 'n' numbers made by 'step'. */
+void wrong_list(char *kind, long n, char *step)
+{
+    fprintf(stderr, "Error! %s of %ld numbers is wrong after %s!\n",
+            kind, n, step);
+    exit(1);
+}
+
+
+/*
+ * Exit unless 'list' holds the 'n' numbers of 'expect', in order or
+ * 'backwards'.  'step' names the step that made the list.
+ */
+void check_list(node *list, int *expect, long n, int backwards,
+                char *step)
+{
+    long i;
+
+    for (i = 0; list != NULL; i++, list = list->next)
+    {
+        if (i >= n || list->data != expect[backwards ? n - 1 - i : i])
+        {
+            wrong_list("A list", n, step);
+        }
+    }
+
+    if (i != n)
+    {
+        wrong_list("A list", n, step);
+    }
+}
+
+
+/* Like 'check_list', for an unrolled list. */
+void check_unrolled(unrolled_list *list, int *expect, long n,
+                    int backwards, char *step)
+{
+    unrolled_node *u;
+    long i = 0;
+    int j;
+
+    for (u = list->head; u != NULL; u = u->next)
+    {
+        for (j = 0; j < u->count; j++, i++)
+        {
+            if (i >= n || u->data[j] != expect[backwards ? n - 1 - i : i])
+            {
+                wrong_list("An unrolled list", n, step);
+            }
+        }
+    }
+
+    if (i != n || list->length != n)
+    {
+        wrong_list("An unrolled list", n, step);
+    }
+}
+
+
+/* Time every step on a plain linked list of the 'n' values. */
+void run_plain(int *values, int *sorted, long n, run_times *t)
+{
+    node *list;
+    node *copy;
+    node *item;
+    double start;
+    long sum;
+    long i;
+
+    /* Build from the back, so the list is in the order of 'values'. */
+    start = now_ns();
+    list = NULL;
+    for (i = n - 1; i >= 0; i--)
+    {
+        list = create_node(values[i], list);
+    }
+    t->step[0] = now_ns() - start;
+
+    start = now_ns();
+    sum = 0;
+    for (item = list; item != NULL; item = item->next)
+    {
+        sum += item->data;
+    }
+    sink = sum;
+    t->step[1] = now_ns() - start;
+
+    start = now_ns();
+    copy = copy_list(list);
+    t->step[2] = now_ns() - start;
+    check_list(copy, values, n, 0, "copy");
+
+    start = now_ns();
+    list = reverse_list_in_place(list);
+    t->step[3] = now_ns() - start;
+    check_list(list, values, n, 1, "reverse");
+
+    start = now_ns();
+    list = merge_sort_list(list);
+    t->step[4] = now_ns() - start;
+    check_list(list, sorted, n, 0, "sort");
+
+    /* Checking a sorted list walks all of it. */
+    start = now_ns();
+    sink = is_sorted(list);
+    t->step[5] = now_ns() - start;
+    if (!sink)
+    {
+        fprintf(stderr, "Error! is_sorted missed a sorted list!\n");
+        exit(1);
+    }
+
+    start = now_ns();
+    free_list(list);
+    free_list(copy);
+    t->step[6] = (now_ns() - start) / 2;
+}
+
+
+/*
+ * Time every step on a plain linked list of the 'n' values, with its
+ * nodes from a node pool.  The pool is freed all at once.
+ */
+void run_pool(int *values, int *sorted, long n, run_times *t)
+{
+    node_pool *pool;
+    node *list;
+    node *copy;
+    node *item;
+    double start;
+    long sum;
+    long i;
+
+    start = now_ns();
+    pool = create_node_pool();
+    list = NULL;
+    for (i = n - 1; i >= 0; i--)
+    {
+        list = pool_create_node(pool, values[i], list);
+    }
+    t->step[0] = now_ns() - start;
+
+    start = now_ns();
+    sum = 0;
+    for (item = list; item != NULL; item = item->next)
+    {
+        sum += item->data;
+    }
+    sink = sum;
+    t->step[1] = now_ns() - start;
+
+    start = now_ns();
+    copy = pool_copy_list(pool, list);
+    t->step[2] = now_ns() - start;
+    check_list(copy, values, n, 0, "copy");
+
+    start = now_ns();
+    list = reverse_list_in_place(list);
+    t->step[3] = now_ns() - start;
+    check_list(list, values, n, 1, "reverse");
+
+    start = now_ns();
+    list = merge_sort_list(list);
+    t->step[4] = now_ns() - start;
+    check_list(list, sorted, n, 0, "sort");
+
+    start = now_ns();
+    sink = is_sorted(list);
+    t->step[5] = now_ns() - start;
+    if (!sink)
+    {
+        fprintf(stderr, "Error! is_sorted missed a sorted list!\n");
+        exit(1);
+    }
+
+    start = now_ns();
+    free_node_pool(pool);
+    t->step[6] = (now_ns() - start) / 2;
+}
+
+
+/* Time every step on an unrolled list of the 'n' values. */
+void run_unrolled(int *values, int *sorted, long n, run_times *t)
+{
+    unrolled_list *list;
+    unrolled_list *copy;
+    unrolled_list *both;
+    unrolled_node *u;
+    int *twice;
+    double start;
+    long sum;
+    long i;
+    int j;
+
+    start = now_ns();
+    list = create_unrolled_list();
+    for (i = 0; i < n; i++)
+    {
+        unrolled_push_back(list, values[i]);
+    }
+    t->step[0] = now_ns() - start;
+
+    start = now_ns();
+    sum = 0;
+    for (u = list->head; u != NULL; u = u->next)
+    {
+        for (j = 0; j < u->count; j++)
+        {
+            sum += u->data[j];
+        }
+    }
+    sink = sum;
+    t->step[1] = now_ns() - start;
+
+    start = now_ns();
+    copy = copy_unrolled_list(list);
+    t->step[2] = now_ns() - start;
+    check_unrolled(copy, values, n, 0, "copy");
+
+    /* Appending is not timed, but checked: the list, then its copy. */
+    twice = (int *)malloc(2 * n * sizeof(int));
+    if (twice == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+    memcpy(twice, values, n * sizeof(int));
+    memcpy(twice + n, values, n * sizeof(int));
+    both = append_unrolled_lists(list, copy);
+    check_unrolled(both, twice, 2 * n, 0, "append");
+    free_unrolled_list(both);
+    free(twice);
+
+    start = now_ns();
+    reverse_unrolled_list(list);
+    t->step[3] = now_ns() - start;
+    check_unrolled(list, values, n, 1, "reverse");
+
+    start = now_ns();
+    sort_unrolled_list(list);
+    t->step[4] = now_ns() - start;
+    check_unrolled(list, sorted, n, 0, "sort");
+
+    start = now_ns();
+    sink = unrolled_is_sorted(list);
+    t->step[5] = now_ns() - start;
+    if (!sink)
+    {
+        fprintf(stderr, "Error! unrolled_is_sorted missed a sorted "
+                "list!\n");
+        exit(1);
+    }
+
+    start = now_ns();
+    free_unrolled_list(list);
+    free_unrolled_list(copy);
+    t->step[6] = (now_ns() - start) / 2;
+}
+
+
+/* Keep the fastest time of each step in 'best'. */
+void keep_fastest(run_times *best, run_times *t)
+{
+    int k;
+
+    for (k = 0; k < NSTEPS; k++)
+    {
+        if (t->step[k] < best->step[k])
+        {
+            best->step[k] = t->step[k];
+        }
+    }
+}
+
+
+/*
+ * Run representation 'rep' 'reps' times on the 'n' values, sorted in
+ * 'sorted', in a child process, and store the fastest time of each step
+ * in 'best'.  Return 0 on success and -1 if the child failed, as it does
+ * if any result is wrong.
+ */
+int time_runs(int rep, int *values, int *sorted, long n, long reps,
+              run_times *best)
+{
+    run_times t;
+    int fd[2];
+    int status;
+    long r;
+    pid_t pid;
+
+    if (pipe(fd) != 0)
+    {
+        return -1;
+    }
+
+    pid = fork();
+    if (pid == 0)
+    {
+        close(fd[0]);
+        for (r = 0; r < reps; r++)
+        {
+            if (rep == UNROLLED)
+            {
+                run_unrolled(values, sorted, n, &t);
+            }
+            else if (rep == POOL)
+            {
+                run_pool(values, sorted, n, &t);
+            }
+            else
+            {
+                run_plain(values, sorted, n, &t);
+            }
+
+            if (r == 0)
+            {
+                *best = t;
+            }
+            keep_fastest(best, &t);
+        }
+        status = (write(fd[1], best, sizeof(*best)) == sizeof(*best));
+        _exit(status ? 0 : 1);
+    }
+
+    close(fd[1]);
+    status = (pid > 0
+              && read(fd[0], best, sizeof(*best)) == sizeof(*best));
+    close(fd[0]);
+
+    if (pid < 0 || waitpid(pid, &status, 0) != pid
+        || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    long sizes[MAX_SIZES];
+    int nsizes = 0;
+    int *values;
+    int *sorted;
+    long n;
+    long reps;
+    long r;
+    int i;
+    int k;
+    run_times times[NREPS];
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc
+            && nsizes < MAX_SIZES)
+        {
+            sizes[nsizes] = atol(argv[++i]);
+            if (sizes[nsizes++] <= 0)
+            {
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            random_state = strtoul(argv[++i], NULL, 10) & 0xffffffffUL;
+            if (random_state == 0)
+            {
+                random_state = 1;
+            }
+        }
+        else
+        {
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    /* By default run 1K to 10M elements; 100M needs about 3 GB. */
+    if (nsizes == 0)
+    {
+        for (n = 1000; n <= 10000000L; n *= 10)
+        {
+            sizes[nsizes++] = n;
+        }
+    }
+
+    printf("%10s %-10s %12s %12s %12s %8s\n", "elements", "step",
+           "list ns/el", "pool", "unrolled", "speedup");
+
+    for (i = 0; i < nsizes; i++)
+    {
+        n = sizes[i];
+        values = (int *)malloc(n * sizeof(int));
+        sorted = (int *)malloc(n * sizeof(int));
+        if (values == NULL || sorted == NULL)
+        {
+            fprintf(stderr, "Error! Memory allocation failed!\n");
+            exit(1);
+        }
+        for (r = 0; r < n; r++)
+        {
+            values[r] = (int)(next_random() & 0x7fffffff);
+        }
+        memcpy(sorted, values, n * sizeof(int));
+        qsort(sorted, n, sizeof(int), compare_ints);
+
+        reps = (n < REPEAT_ELEMENTS) ? REPEAT_ELEMENTS / n : 1;
+        if (reps > 100)
+        {
+            reps = 100;
+        }
+
+        for (k = 0; k < NREPS; k++)
+        {
+            if (time_runs(k, values, sorted, n, reps, &times[k]) != 0)
+            {
+                fprintf(stderr, "Benchmark run of the %s failed!\n",
+                        rep_names[k]);
+                return 1;
+            }
+        }
+
+        /* The speedup is of the unrolled list over the plain one. */
+        for (k = 0; k < NSTEPS; k++)
+        {
+            printf("%10ld %-10s %12.2f %12.2f %12.2f %7.1fx\n", n,
+                   step_names[k], times[PLAIN].step[k] / n,
+                   times[POOL].step[k] / n, times[UNROLLED].step[k] / n,
+                   times[PLAIN].step[k] / times[UNROLLED].step[k]);
+        }
+        fflush(stdout);
+
+        free(values);
+        free(sorted);
+    }
+
+    printf("* The lists are sorted by relinking their nodes; the unrolled "
+           "list copies its\n  numbers to an array, sorts the array and "
+           "copies them back.\n");
+
+    print_memory_leaks();
+    return 0;
+}
@@ -0,0 +1,287 @@
+/*
+ * FILE: bench_sort.c
+ *     Benchmark of the array sorts.  Arrays of random numbers are sorted
+ *     with the introsort, with the radix sort, and with the parallel
+ *     sort on more and more threads, and the time per number of each
+ *     sort and its speedup over the introsort are printed.  Small arrays
+ *     are sorted many times and the fastest time is kept; each time has
+ *     different numbers, so that the branch predictor cannot learn them
+ *     and flatter the comparison sorts.  Every result
+ *     is checked against the introsort.  The radix sort is timed even on
+ *     arrays that 'radix_sort_ints' would give to the introsort, and the
+ *     last line gives the size from which it beats the introsort.
+ */
+
+/* Needed for clock_gettime under -ansi. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "array_sort.h"
+#include "parallel_sort.h"
+
+#define MAX_SIZES 16
+#define MAX_THREAD_COUNTS 16
+
+/* Arrays shorter than this are sorted several times. */
+#define REPEAT_ELEMENTS 1000000L
+#define MAX_REPEATS 1000
+
+#define INTROSORT 0
+#define RADIX_SORT 1
+#define PARALLEL_SORT 2
+
+
+void usage(char *progname);
+unsigned long next_random(void);
+double now_ns(void);
+double time_sort(int sort, int *values, int *a, int *sorted, long n,
+                 long reps, int nthreads, long threshold);
+
+
+/* The buffer for the radix sort. */
+int *radix_buffer;
+
+
+unsigned long random_state = 2463534242UL;
+
+
+void usage(char *progname)
+{
+    fprintf(stderr, "usage: %s [-n elements]... [-j threads]... "
+            "[-t threshold] [-s seed]\n", progname);
+}
+
+
+/* 32-bit xorshift random number generator. */
+unsigned long next_random(void)
+{
+    random_state ^= (random_state << 13) & 0xffffffffUL;
+    random_state ^= random_state >> 17;
+    random_state ^= (random_state << 5) & 0xffffffffUL;
+    return random_state;
+}
+
+
+/* Current time in nanoseconds. */
+double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+/*
+ * Sort copies of 'reps' arrays of 'n' values, one after another in
+ * 'values', in 'a' with one of the sorts, and return the fastest time.
+ * If 'sorted' is not NULL, exit if the last result differs from it.
+ */
+double time_sort(int sort, int *values, int *a, int *sorted, long n,
+                 long reps, int nthreads, long threshold)
+{
+    double best = 0;
+    double start;
+    double t;
+    long r;
+
+    for (r = 0; r < reps; r++)
+    {
+        memcpy(a, values + r * n, n * sizeof(int));
+        start = now_ns();
+        if (sort == INTROSORT)
+        {
+            introsort(a, n);
+        }
+        else if (sort == RADIX_SORT)
+        {
+            radix_sort_with_buffer(a, radix_buffer, n);
+        }
+        else
+        {
+            parallel_sort(a, n, nthreads, threshold);
+        }
+        t = now_ns() - start;
+
+        if (r == 0 || t < best)
+        {
+            best = t;
+        }
+    }
+
+    if (sorted != NULL && memcmp(a, sorted, n * sizeof(int)) != 0)
+    {
+        fprintf(stderr, "Error! A sort of %ld numbers gave a wrong "
+                "result!\n", n);
+        exit(1);
+    }
+
+    return best;
+}
+
+
+int main(int argc, char **argv)
+{
+    long sizes[MAX_SIZES];
+    int threads[MAX_THREAD_COUNTS];
+    int nsizes = 0;
+    int nthreads = 0;
+    long threshold = PARALLEL_SORT_THRESHOLD;
+    long crossover = 0;
+    int *values;
+    int *sorted;
+    int *a;
+    long n;
+    long reps;
+    long r;
+    int i;
+    int k;
+    double base;
+    double t;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc
+            && nsizes < MAX_SIZES)
+        {
+            sizes[nsizes] = atol(argv[++i]);
+            if (sizes[nsizes++] <= 0)
+            {
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc
+                 && nthreads < MAX_THREAD_COUNTS)
+        {
+            threads[nthreads] = atoi(argv[++i]);
+            if (threads[nthreads++] <= 0)
+            {
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            threshold = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            random_state = strtoul(argv[++i], NULL, 10) & 0xffffffffUL;
+            if (random_state == 0)
+            {
+                random_state = 1;
+            }
+        }
+        else
+        {
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    /* By default sort 16 to 16M numbers; 100M needs about 1.6 GB. */
+    if (nsizes == 0)
+    {
+        for (n = 16; n <= 16777216L; n *= 4)
+        {
+            sizes[nsizes++] = n;
+        }
+    }
+
+    /* By default double the threads up to the number of processors. */
+    if (nthreads == 0)
+    {
+        for (k = 2; k < processors_online() && nthreads < MAX_THREAD_COUNTS;
+             k *= 2)
+        {
+            threads[nthreads++] = k;
+        }
+        if (processors_online() > 1)
+        {
+            threads[nthreads++] = processors_online();
+        }
+    }
+
+    printf("%10s %-10s %8s %12s %8s\n", "elements", "sort", "threads",
+           "ns/el", "speedup");
+
+    for (i = 0; i < nsizes; i++)
+    {
+        n = sizes[i];
+        reps = REPEAT_ELEMENTS / n;
+        if (reps < 1)
+        {
+            reps = 1;
+        }
+        if (reps > MAX_REPEATS)
+        {
+            reps = MAX_REPEATS;
+        }
+
+        values = (int *)malloc(reps * n * sizeof(int));
+        sorted = (int *)malloc(n * sizeof(int));
+        a = (int *)malloc(n * sizeof(int));
+        radix_buffer = (int *)malloc(n * sizeof(int));
+        if (values == NULL || sorted == NULL || a == NULL
+            || radix_buffer == NULL)
+        {
+            fprintf(stderr, "Error! Memory allocation failed!\n");
+            exit(1);
+        }
+        for (r = 0; r < reps * n; r++)
+        {
+            values[r] = (int)next_random();
+        }
+
+        base = time_sort(INTROSORT, values, sorted, NULL, n, reps, 1,
+                         threshold);
+        printf("%10ld %-10s %8d %12.2f %7.1fx\n", n, "introsort", 1,
+               base / n, 1.0);
+
+        t = time_sort(RADIX_SORT, values, a, sorted, n, reps, 1, threshold);
+        printf("%10ld %-10s %8d %12.2f %7.1fx\n", n, "radix", 1,
+               t / n, base / t);
+
+        /* Remember the smallest size from which the radix sort wins. */
+        if (t < base && crossover == 0)
+        {
+            crossover = n;
+        }
+        else if (t >= base)
+        {
+            crossover = 0;
+        }
+
+        /* Smaller arrays are not split, so are not worth timing. */
+        for (k = 0; k < nthreads && n > threshold; k++)
+        {
+            t = time_sort(PARALLEL_SORT, values, a, sorted, n, reps,
+                          threads[k], threshold);
+            printf("%10ld %-10s %8d %12.2f %7.1fx\n", n, "parallel",
+                   threads[k], t / n, base / t);
+        }
+        fflush(stdout);
+
+        free(values);
+        free(sorted);
+        free(a);
+        free(radix_buffer);
+    }
+
+    if (crossover > 0)
+    {
+        printf("The radix sort beats the introsort from %ld numbers on.\n",
+               crossover);
+    }
+    else
+    {
+        printf("The radix sort did not beat the introsort at the largest "
+               "size.\n");
+    }
+
+    return 0;
+}
@@ -59,84 +59,130 @@ free_list(node *list)
 
 
 /*
- * copy_list:
- *     Return a copy of a list.
+ * copy_list_with_tail:
+ *     Return a copy of a list, and store its last node in '*tail' (NULL
+ *     if the list is empty).  The copy is made in a single pass, adding
+ *     each new node after the last one, so it takes no stack however
+ *     long the list is.
  */
 
 node *
-copy_list(node *list)
+copy_list_with_tail(node *list, node **tail)
 {
-    if (list == NULL)
-    {
-        return list;
-    }
-    else
-    {
-        node *new_list;
-
-        new_list = (node *)malloc(sizeof(node));
+    node *new_list = NULL;
+    node *last = NULL;
+    node *item;
 
-        if (new_list == NULL)
+    for (item = list; item != NULL; item = item->next)
+    {
+        if (last == NULL)
         {
-            fprintf(stderr, "Fatal error: out of memory. "
-                    "Terminating program.\n");
-            exit(1);
+            new_list = create_node(item->data, NULL);
+            last = new_list;
+        }
+        else
+        {
+            last->next = create_node(item->data, NULL);
+            last = last->next;
         }
-
-        new_list->data = list->data;
-        new_list->next = copy_list(list->next);
-        return new_list;
     }
+
+    *tail = last;
+    return new_list;
 }
 
 
+/*
+ * copy_list:
+ *     Return a copy of a list.
+ */
+
+node *
+copy_list(node *list)
+{
+    node *tail;
+
+    return copy_list_with_tail(list, &tail);
+}
+
 
 /*
  * append_lists:
  *     Return a list which is a copy of the concatenation of the two
- *     input lists.
+ *     input lists.  The copy of 'list2' is linked straight after the
+ *     last node of the copy of 'list1', so each list is walked once.
  */
 
 node *
 append_lists(node *list1, node *list2)
 {
-    node *item;
+    node *new_list1;
+    node *tail;
 
-    if (list1 == NULL)
+    new_list1 = copy_list_with_tail(list1, &tail);
+
+    if (new_list1 == NULL)
     {
         return copy_list(list2);
     }
-    else if (list2 == NULL)
+
+    tail->next = copy_list(list2);
+    return new_list1;
+}
+
+
+/*
+ * join_lists:
+ *     Add the list from 'list' to 'list_tail' to the end of the list
+ *     from '*head' to '*tail', by relinking, in constant time.  Both
+ *     '*head' and '*tail' are NULL for an empty list, as are 'list' and
+ *     'list_tail'.
+ */
+
+void
+join_lists(node **head, node **tail, node *list, node *list_tail)
+{
+    if (list == NULL)
+    {
+        return;
+    }
+
+    if (*head == NULL)
     {
-        return copy_list(list1);
+        *head = list;
     }
     else
     {
-        node *new_list1 = copy_list(list1);
-        node *new_list2 = copy_list(list2);
+        (*tail)->next = list;
+    }
+    *tail = list_tail;
+}
 
-        /*
-         * Find the end of 'new_list1' and change its 'next' pointer
-         * to point to 'new_list2'.
-         */
 
-        for (item = new_list1; item != NULL; item = item->next)
-        {
-            if (item->next == NULL)  /* We're on the last node. */
-            {
-                item->next = new_list2;
+/*
+ * append_lists_in_place:
+ *     Return the concatenation of two lists, made by linking the last
+ *     node of 'list1' to 'list2'.  Nothing is copied, and both input
+ *     lists become part of the result.
+ */
 
-                /*
-                 * Now 'new_list1' contains the copy of both lists
-                 * appended together.
-                 */
+node *
+append_lists_in_place(node *list1, node *list2)
+{
+    node *item;
 
-                break;
-            }
-        }
+    if (list1 == NULL)
+    {
+        return list2;
+    }
 
-        return new_list1;
+    for (item = list1; item->next != NULL; item = item->next)
+    {
+        ;
     }
+    item->next = list2;
+
+    return list1;
 }
 
 
@@ -159,6 +205,125 @@ reverse_list(node *list)
 }
 
 
+/*
+ * merge_sort_list:
+ *     Sort a list in place, by relinking its nodes, and return the
+ *     sorted list.  This is a bottom-up merge sort: sorted runs of
+ *     length 1, 2, 4, ... are merged pairwise, one pass per length,
+ *     until a pass makes only one merge.  It needs no recursion and no
+ *     extra memory, takes O(N log N) time even on sorted or reversed
+ *     input, and keeps equal values in their original order.
+ */
+
+node *
+merge_sort_list(node *list)
+{
+    node *p, *q;         /* the two runs being merged */
+    node *e;             /* the node taken from one of them */
+    node *head, *tail;   /* the merged list built by this pass */
+    int width;           /* the length of the runs in this pass */
+    int psize, qsize;
+    int nmerges;
+    int i;
+
+    if (list == NULL)
+    {
+        return NULL;
+    }
+
+    for (width = 1; ; width *= 2)
+    {
+        p = list;
+        head = NULL;
+        tail = NULL;
+        nmerges = 0;
+
+        while (p != NULL)
+        {
+            nmerges++;
+
+            /* The run at 'q' starts 'width' nodes after 'p'. */
+            q = p;
+            psize = 0;
+            for (i = 0; i < width && q != NULL; i++)
+            {
+                psize++;
+                q = q->next;
+            }
+            qsize = width;
+
+            while (psize > 0 || (qsize > 0 && q != NULL))
+            {
+                /* Take from 'p' on ties, so the sort is stable. */
+                if (psize == 0)
+                {
+                    e = q;
+                    q = q->next;
+                    qsize--;
+                }
+                else if (qsize == 0 || q == NULL || p->data <= q->data)
+                {
+                    e = p;
+                    p = p->next;
+                    psize--;
+                }
+                else
+                {
+                    e = q;
+                    q = q->next;
+                    qsize--;
+                }
+
+                if (tail == NULL)
+                {
+                    head = e;
+                }
+                else
+                {
+                    tail->next = e;
+                }
+                tail = e;
+            }
+
+            /* The next pair of runs starts where this one ended. */
+            p = q;
+        }
+
+        tail->next = NULL;
+        list = head;
+
+        if (nmerges <= 1)
+        {
+            return list;
+        }
+    }
+}
+
+
+/*
+ * reverse_list_in_place:
+ *     Reverse a list by turning its 'next' pointers around, and return
+ *     the new first node.  Nothing is copied.
+ */
+
+node *
+reverse_list_in_place(node *list)
+{
+    node *reversed_list = NULL;
+    node *next;
+
+    while (list != NULL)
+    {
+        next = list->next;
+        list->next = reversed_list;
+        reversed_list = list;
+        list = next;
+    }
+
+    return reversed_list;
+}
+
+
 /*
  * Print the elements of a list.
  */
@@ -208,3 +373,158 @@ is_sorted(node *list)
 }
 
 
+/*
+ * create_node_pool:
+ *     Make an empty node pool.  The first block is only allocated when
+ *     the first node is needed.
+ */
+
+node_pool *
+create_node_pool(void)
+{
+    node_pool *pool = (node_pool *)malloc(sizeof(node_pool));
+
+    if (pool == NULL)
+    {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    pool->blocks = NULL;
+    pool->used = NODE_POOL_BLOCK;
+    pool->free_nodes = NULL;
+
+    return pool;
+}
+
+
+/*
+ * free_node_pool:
+ *     Free a pool and all its blocks.  Any node taken from the pool is
+ *     freed with it, so no list using the pool may be used afterwards.
+ */
+
+void
+free_node_pool(node_pool *pool)
+{
+    node_block *block;
+
+    while (pool->blocks != NULL)
+    {
+        block = pool->blocks;
+        pool->blocks = block->next;
+        free(block);
+    }
+
+    free(pool);
+}
+
+
+/*
+ * pool_create_node:
+ *     Take a node from 'pool', reusing a node given back if there is
+ *     one, fill it in and link it to the node called 'n'.
+ */
+
+node *
+pool_create_node(node_pool *pool, int data, node *n)
+{
+    node_block *block;
+    node *result;
+
+    if (pool->free_nodes != NULL)
+    {
+        result = pool->free_nodes;
+        pool->free_nodes = result->next;
+    }
+    else
+    {
+        if (pool->used == NODE_POOL_BLOCK)
+        {
+            block = (node_block *)malloc(sizeof(node_block));
+
+            if (block == NULL)
+            {
+                fprintf(stderr, "Fatal error: out of memory. "
+                        "Terminating program.\n");
+                exit(1);
+            }
+
+            block->next = pool->blocks;
+            pool->blocks = block;
+            pool->used = 0;
+        }
+
+        result = &pool->blocks->nodes[pool->used++];
+    }
+
+    result->data = data;
+    result->next = n;
+
+    return result;
+}
+
+
+/*
+ * pool_free_node:
+ *     Give a node back to its pool, to be reused by a later
+ *     'pool_create_node'.
+ */
+
+void
+pool_free_node(node_pool *pool, node *n)
+{
+    n->next = pool->free_nodes;
+    pool->free_nodes = n;
+}
+
+
+/*
+ * pool_free_list:
+ *     Give all the nodes of a list back to their pool.
+ */
+
+void
+pool_free_list(node_pool *pool, node *list)
+{
+    node *n;
+
+    while (list != NULL)
+    {
+        n = list;
+        list = list->next;
+        pool_free_node(pool, n);
+    }
+}
+
+
+/*
+ * pool_copy_list:
+ *     Return a copy of a list, made of nodes from 'pool'.  The copy is
+ *     built front to back, so its nodes are in order in memory.
+ */
+
+node *
+pool_copy_list(node_pool *pool, node *list)
+{
+    node *new_list = NULL;
+    node *tail = NULL;
+    node *item;
+
+    for (item = list; item != NULL; item = item->next)
+    {
+        if (tail == NULL)
+        {
+            new_list = pool_create_node(pool, item->data, NULL);
+            tail = new_list;
+        }
+        else
+        {
+            tail->next = pool_create_node(pool, item->data, NULL);
+            tail = tail->next;
+        }
+    }
+
+    return new_list;
+}
@@ -25,20 +25,90 @@ node *create_node(int data, node *n);
 /* Free all the nodes of a linked list. */
 void free_list(node *list);
 
-/* Return a copy of a list. */
+/*
+ * Return a copy of a list.  These and the other list functions work in
+ * a loop, so they need no more stack for long lists than for short ones.
+ */
 node *copy_list(node *list);
 
+/* Return a copy of a list, and store its last node in '*tail'. */
+node *copy_list_with_tail(node *list, node **tail);
+
 /* Append two lists non-destructively.  The input lists are not altered. */
 node *append_lists(node *list1, node *list2);
 
 /* Make a reversed copy of a list.  The input list is not altered. */
 node *reverse_list(node *list);
 
+/*
+ * The functions below change their input lists instead of copying them,
+ * and allocate nothing.
+ */
+
+/*
+ * Add the list from 'list' to 'list_tail' to the end of the list from
+ * '*head' to '*tail' (all NULL for empty lists), in constant time.
+ */
+void join_lists(node **head, node **tail, node *list, node *list_tail);
+
+/* Link 'list2' to the end of 'list1' and return the joined list. */
+node *append_lists_in_place(node *list1, node *list2);
+
+/* Reverse a list by relinking its nodes, and return the new head. */
+node *reverse_list_in_place(node *list);
+
+/*
+ * Sort a list in place with a bottom-up merge sort, and return the
+ * sorted list.  Stable, O(N log N) in the worst case, no extra memory.
+ */
+node *merge_sort_list(node *list);
+
 /* Print the elements of a list. */
 void print_list(node *list);
 
 /* Return 1 if a list is sorted, otherwise 0. */
 int is_sorted(node *list);
 
+
+/*
+ * A node pool hands out nodes from blocks of NODE_POOL_BLOCK nodes, so
+ * that nodes made one after another sit next to each other in memory
+ * and most nodes cost no call to 'malloc'.  Nodes given back to the
+ * pool are kept on a free list for reuse, and all the blocks are freed
+ * at once when the pool is.
+ */
+
+#define NODE_POOL_BLOCK 1024
+
+typedef struct _node_block
+{
+  struct _node_block *next;       /* the previously allocated block */
+  node nodes[NODE_POOL_BLOCK];
+} node_block;
+
+typedef struct
+{
+  node_block *blocks;   /* all blocks, newest first */
+  int used;             /* nodes handed out from the newest block */
+  node *free_nodes;     /* nodes given back, linked through 'next' */
+} node_pool;
+
+
+/* Make an empty node pool. */
+node_pool *create_node_pool(void);
+
+/* Free a pool and every node in it, whether in use or not. */
+void free_node_pool(node_pool *pool);
+
+/* Like 'create_node', but take the node from 'pool'. */
+node *pool_create_node(node_pool *pool, int data, node *n);
+
+/* Give one node, or all the nodes of a list, back to 'pool'. */
+void pool_free_node(node_pool *pool, node *n);
+void pool_free_list(node_pool *pool, node *list);
+
+/* Return a copy of a list made of nodes from 'pool'. */
+node *pool_copy_list(node_pool *pool, node *list);
+
 #endif  /* LINKED_LIST_H */
 
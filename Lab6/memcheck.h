@@ -9,25 +9,102 @@
 #define MEMCHECK_H
 
 #include <stdlib.h>
+#include <string.h>
 
 void *checked_malloc_fn(size_t size, char *filename, int lineno);
 void *checked_calloc_fn(size_t nmemb, size_t size,
                         char *filename, int lineno);
+void *checked_realloc_fn(void *ptr, size_t size,
+                         char *filename, int lineno);
+char *checked_strdup_fn(const char *s, char *filename, int lineno);
+void *checked_aligned_alloc_fn(size_t alignment, size_t size,
+                               char *filename, int lineno);
+int   checked_posix_memalign_fn(void **memptr, size_t alignment,
+                                size_t size, char *filename, int lineno);
 void  checked_free_fn(void *ptr, char *filename, int lineno);
 void  print_memory_leaks(void);
 
+/*
+ * Print the allocations made so far, by call site, to stderr.  Only has
+ * anything to print when the program runs with MEMCHECK_PROFILE set; it
+ * is then also called at exit and after SIGUSR1.
+ */
+
+void  print_allocation_profile(void);
+
+/*
+ * Live heap statistics, which can be read at any time.  Blocks freed
+ * from other threads may make them a little out of date.
+ */
+
+typedef struct
+{
+    unsigned long live_bytes;   /* Bytes allocated and not yet freed. */
+    unsigned long live_blocks;
+    unsigned long peak_bytes;   /* Highest value of 'live_bytes'.     */
+    unsigned long allocs;       /* Allocations so far.                */
+    unsigned long frees;        /* Frees so far.                      */
+    unsigned long node_bytes;   /* Bytes of memcheck's own records.   */
+} memcheck_stats;
+
+void  get_memcheck_stats(memcheck_stats *stats);
+void  print_memcheck_stats(void);
+
+/*
+ * Snapshots of the live memory by call site.  Printing the difference
+ * between two snapshots shows which call sites grew in between.
+ */
+
+typedef struct _memcheck_snapshot memcheck_snapshot;
+
+memcheck_snapshot *take_memcheck_snapshot(void);
+void  free_memcheck_snapshot(memcheck_snapshot *snap);
+void  print_memcheck_snapshot_diff(memcheck_snapshot *before,
+                                   memcheck_snapshot *after);
+
 /*
  * Macros which maintain the interface of the standard malloc/calloc/free
  * functions.  Don't include these if this file is being included into
  * memcheck.c, or it will screw up the definitions of the checked functions.
+ *
+ * <string.h> and <stdlib.h> are included above so that their declarations
+ * are read before these macros exist; 'strdup' may itself be a macro in
+ * <string.h>, so it is undefined first.
+ *
+ * When MEMCHECK_DISABLED is defined (as 'make release' does), none of the
+ * allocation macros are defined, so programs call the C library directly
+ * and need not link memcheck.o, and the report functions do nothing.
  */
 
 #ifndef MEMCHECK_C
 
+#ifdef MEMCHECK_DISABLED
+
+#define print_memory_leaks()       ((void) 0)
+#define print_allocation_profile() ((void) 0)
+#define get_memcheck_stats(s)      memset((s), 0, sizeof(memcheck_stats))
+#define print_memcheck_stats()     ((void) 0)
+#define take_memcheck_snapshot()   ((memcheck_snapshot *) NULL)
+#define free_memcheck_snapshot(s)  ((void) (s))
+#define print_memcheck_snapshot_diff(a, b) ((void) 0)
+
+#else   /* MEMCHECK_DISABLED */
+
 #define malloc(n)    checked_malloc_fn((n), __FILE__, __LINE__)
 #define calloc(n, m) checked_calloc_fn((n), (m), __FILE__, __LINE__)
+#define realloc(p, n) checked_realloc_fn((p), (n), __FILE__, __LINE__)
 #define free(p)      checked_free_fn((p), __FILE__, __LINE__)
 
+#undef  strdup
+#define strdup(s)    checked_strdup_fn((s), __FILE__, __LINE__)
+
+#define aligned_alloc(a, n) \
+    checked_aligned_alloc_fn((a), (n), __FILE__, __LINE__)
+#define posix_memalign(pp, a, n) \
+    checked_posix_memalign_fn((pp), (a), (n), __FILE__, __LINE__)
+
+#endif  /* MEMCHECK_DISABLED */
+
 #endif  /* MEMCHECK_C */
 
 #endif  /* MEMCHECK_H */
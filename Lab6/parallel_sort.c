@@ -0,0 +1,525 @@
+/*
+ * FILE: parallel_sort.c
+ *     Multithreaded merge sort.  Each thread keeps a deque of tasks: it
+ *     adds and takes its own tasks at the bottom, and other threads
+ *     steal from the top, where the oldest and largest tasks are.  A
+ *     thread waiting for its tasks to finish runs other tasks meanwhile,
+ *     so no thread sits blocked while there is work to do.
+ */
+
+/* Needed for pthreads, sched_yield and sysconf under -ansi. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "memcheck.h"
+#include "array_sort.h"
+#include "parallel_sort.h"
+
+/* Most tasks waiting in one deque; any more run at once. */
+#define DEQUE_SIZE 256
+
+#define SORT_TASK 0
+#define MERGE_TASK 1
+
+
+/*
+ * A piece of work.  A sort task sorts 'n' numbers at 'a', leaving them
+ * in 'b' if 'to_b' is set, and uses the other array as a buffer.  A
+ * merge task merges 'nx' numbers at 'x' and 'ny' at 'y' into 'out'.
+ * When a task is done, its 'pending' counter goes down by one.
+ */
+
+typedef struct
+{
+    int kind;
+    int *a, *b;
+    long n;
+    int to_b;
+    int *x, *y, *out;
+    long nx, ny;
+    volatile long *pending;
+} sort_task;
+
+typedef struct
+{
+    pthread_mutex_t lock;
+    sort_task *tasks[DEQUE_SIZE];
+    int top;                    /* the next task to steal */
+    int bottom;                 /* one past the newest task */
+} task_deque;
+
+typedef struct _sort_pool sort_pool;
+
+typedef struct
+{
+    sort_pool *pool;
+    int id;
+    unsigned long seed;         /* for picking threads to steal from */
+    pthread_t thread;
+} sort_worker;
+
+struct _sort_pool
+{
+    int nworkers;
+    long threshold;
+    int done;                   /* set when the workers should stop */
+    task_deque deques[MAX_SORT_THREADS];
+    sort_worker workers[MAX_SORT_THREADS];
+};
+
+
+void spawn_task(sort_worker *w, sort_task *t, volatile long *pending);
+sort_task *take_task(sort_worker *w);
+sort_task *steal_task(sort_worker *w);
+void run_task(sort_worker *w, sort_task *t);
+void wait_for_tasks(sort_worker *w, volatile long *pending);
+void *worker_main(void *arg);
+void merge_sort_range(sort_worker *w, int *a, int *b, long n, int to_b);
+void merge_range(sort_worker *w, int *x, long nx, int *y, long ny,
+                 int *out);
+void merge_ints(int *x, long nx, int *y, long ny, int *out);
+long lower_bound(int *a, long n, int value);
+
+
+/*
+ * spawn_task:
+ *     Add a task to the bottom of the deque of 'w', to be run by 'w'
+ *     later or stolen by another thread.  If the deque is full, run it
+ *     now instead.
+ */
+
+void
+spawn_task(sort_worker *w, sort_task *t, volatile long *pending)
+{
+    task_deque *d = &w->pool->deques[w->id];
+
+    t->pending = pending;
+    __sync_fetch_and_add(pending, 1);
+
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom < DEQUE_SIZE)
+    {
+        d->tasks[d->bottom++] = t;
+        t = NULL;
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    if (t != NULL)
+    {
+        run_task(w, t);
+    }
+}
+
+
+/*
+ * take_task:
+ *     Take the newest task from the bottom of the deque of 'w', or
+ *     return NULL if it is empty.
+ */
+
+sort_task *
+take_task(sort_worker *w)
+{
+    task_deque *d = &w->pool->deques[w->id];
+    sort_task *t = NULL;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->bottom > d->top)
+    {
+        t = d->tasks[--d->bottom];
+        if (d->bottom == d->top)
+        {
+            d->top = d->bottom = 0;
+        }
+    }
+    pthread_mutex_unlock(&d->lock);
+
+    return t;
+}
+
+
+/*
+ * steal_task:
+ *     Take the oldest task from the top of the deque of some other
+ *     thread, starting with a random one, or return NULL if every deque
+ *     is empty.
+ */
+
+sort_task *
+steal_task(sort_worker *w)
+{
+    sort_pool *pool = w->pool;
+    task_deque *d;
+    sort_task *t = NULL;
+    int start;
+    int i;
+
+    w->seed = w->seed * 1103515245UL + 12345UL;
+    start = (int)((w->seed >> 16) % pool->nworkers);
+
+    for (i = 0; i < pool->nworkers && t == NULL; i++)
+    {
+        d = &pool->deques[(start + i) % pool->nworkers];
+
+        /* A deque in use by another thread is skipped, not waited for. */
+        if (d == &pool->deques[w->id] || pthread_mutex_trylock(&d->lock) != 0)
+        {
+            continue;
+        }
+
+        if (d->bottom > d->top)
+        {
+            t = d->tasks[d->top++];
+            if (d->bottom == d->top)
+            {
+                d->top = d->bottom = 0;
+            }
+        }
+        pthread_mutex_unlock(&d->lock);
+    }
+
+    return t;
+}
+
+
+/*
+ * run_task:
+ *     Do the work of a task, then count it as finished.
+ */
+
+void
+run_task(sort_worker *w, sort_task *t)
+{
+    if (t->kind == SORT_TASK)
+    {
+        merge_sort_range(w, t->a, t->b, t->n, t->to_b);
+    }
+    else
+    {
+        merge_range(w, t->x, t->nx, t->y, t->ny, t->out);
+    }
+
+    /* This also makes the results visible to the waiting thread. */
+    __sync_fetch_and_sub(t->pending, 1);
+}
+
+
+/*
+ * wait_for_tasks:
+ *     Run tasks, its own first, until the tasks counted by 'pending' are
+ *     all finished.
+ */
+
+void
+wait_for_tasks(sort_worker *w, volatile long *pending)
+{
+    sort_task *t;
+
+    /* Reading the counter atomically also makes the results visible. */
+    while (__sync_fetch_and_add(pending, 0) > 0)
+    {
+        t = take_task(w);
+        if (t == NULL)
+        {
+            t = steal_task(w);
+        }
+
+        if (t != NULL)
+        {
+            run_task(w, t);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+}
+
+
+/*
+ * worker_main:
+ *     The loop of every thread but the first: steal and run tasks until
+ *     the sort is done.
+ */
+
+void *
+worker_main(void *arg)
+{
+    sort_worker *w = (sort_worker *)arg;
+    sort_task *t;
+
+    while (__sync_fetch_and_add(&w->pool->done, 0) == 0)
+    {
+        t = take_task(w);
+        if (t == NULL)
+        {
+            t = steal_task(w);
+        }
+
+        if (t != NULL)
+        {
+            run_task(w, t);
+        }
+        else
+        {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * merge_sort_range:
+ *     Sort 'n' numbers at 'a', and leave them in 'a', or in 'b' if
+ *     'to_b' is set.  The halves are sorted into the other array, so
+ *     that merging them puts the result where it belongs; only pieces
+ *     that are sorted straight into 'b' need copying.
+ */
+
+void
+merge_sort_range(sort_worker *w, int *a, int *b, long n, int to_b)
+{
+    sort_task left;
+    volatile long pending = 0;
+    long half;
+
+    if (n <= w->pool->threshold)
+    {
+        introsort(a, n);
+        if (to_b)
+        {
+            memcpy(b, a, n * sizeof(int));
+        }
+        return;
+    }
+
+    half = n / 2;
+    left.kind = SORT_TASK;
+    left.a = a;
+    left.b = b;
+    left.n = half;
+    left.to_b = !to_b;
+    spawn_task(w, &left, &pending);
+
+    merge_sort_range(w, a + half, b + half, n - half, !to_b);
+    wait_for_tasks(w, &pending);
+
+    if (to_b)
+    {
+        merge_range(w, a, half, a + half, n - half, b);
+    }
+    else
+    {
+        merge_range(w, b, half, b + half, n - half, a);
+    }
+}
+
+
+/*
+ * merge_range:
+ *     Merge the sorted numbers at 'x' and 'y' into 'out'.  A long merge
+ *     is split at the middle number of the longer input: the numbers
+ *     before it in both inputs go before it in 'out', and the rest after
+ *     it, so the two parts can be merged at the same time.
+ */
+
+void
+merge_range(sort_worker *w, int *x, long nx, int *y, long ny, int *out)
+{
+    sort_task left;
+    volatile long pending = 0;
+    long mid, pos;
+    int *t;
+
+    if (nx + ny <= w->pool->threshold)
+    {
+        merge_ints(x, nx, y, ny, out);
+        return;
+    }
+
+    if (nx < ny)
+    {
+        t = x; x = y; y = t;
+        mid = nx; nx = ny; ny = mid;
+    }
+
+    mid = nx / 2;
+    pos = lower_bound(y, ny, x[mid]);
+    out[mid + pos] = x[mid];
+
+    left.kind = MERGE_TASK;
+    left.x = x;
+    left.nx = mid;
+    left.y = y;
+    left.ny = pos;
+    left.out = out;
+    spawn_task(w, &left, &pending);
+
+    merge_range(w, x + mid + 1, nx - mid - 1, y + pos, ny - pos,
+                out + mid + pos + 1);
+    wait_for_tasks(w, &pending);
+}
+
+
+/*
+ * merge_ints:
+ *     Merge the sorted numbers at 'x' and 'y' into 'out' on one thread.
+ */
+
+void
+merge_ints(int *x, long nx, int *y, long ny, int *out)
+{
+    long i = 0, j = 0, k = 0;
+
+    while (i < nx && j < ny)
+    {
+        if (y[j] < x[i])
+        {
+            out[k++] = y[j++];
+        }
+        else
+        {
+            out[k++] = x[i++];
+        }
+    }
+
+    memcpy(out + k, x + i, (nx - i) * sizeof(int));
+    memcpy(out + k + nx - i, y + j, (ny - j) * sizeof(int));
+}
+
+
+/*
+ * lower_bound:
+ *     Return the index of the first of 'n' sorted numbers that is not
+ *     smaller than 'value', or 'n' if there is none.
+ */
+
+long
+lower_bound(int *a, long n, int value)
+{
+    long lo = 0, hi = n, mid;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (a[mid] < value)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+
+/*
+ * parallel_sort:
+ *     Sort 'n' numbers in place on 'nthreads' threads.  The calling
+ *     thread works as the first of them.
+ */
+
+void
+parallel_sort(int *a, long n, int nthreads, long threshold)
+{
+    sort_pool *pool;
+    int *b;
+    int nstarted;
+    int i;
+
+    if (threshold < 1)
+    {
+        threshold = 1;
+    }
+    if (nthreads > MAX_SORT_THREADS)
+    {
+        nthreads = MAX_SORT_THREADS;
+    }
+
+    if (nthreads <= 1 || n <= threshold)
+    {
+        introsort(a, n);
+        return;
+    }
+
+    b = (int *)malloc(n * sizeof(int));
+    pool = (sort_pool *)malloc(sizeof(sort_pool));
+    if (b == NULL || pool == NULL)
+    {
+        if (b != NULL)
+        {
+            free(b);
+        }
+        if (pool != NULL)
+        {
+            free(pool);
+        }
+        introsort(a, n);
+        return;
+    }
+
+    pool->threshold = threshold;
+    pool->done = 0;
+    for (i = 0; i < nthreads; i++)
+    {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+        pool->deques[i].top = 0;
+        pool->deques[i].bottom = 0;
+        pool->workers[i].pool = pool;
+        pool->workers[i].id = i;
+        pool->workers[i].seed = 2463534242UL + i;
+    }
+
+    /*
+     * Make as many of the other threads as the system allows.  The deques
+     * of threads that could not be made stay empty, so stealing from
+     * them just finds nothing.
+     */
+    pool->nworkers = nthreads;
+    for (nstarted = 1; nstarted < nthreads; nstarted++)
+    {
+        if (pthread_create(&pool->workers[nstarted].thread, NULL,
+                           worker_main, &pool->workers[nstarted]) != 0)
+        {
+            break;
+        }
+    }
+
+    merge_sort_range(&pool->workers[0], a, b, n, 0);
+
+    __sync_fetch_and_add(&pool->done, 1);
+    for (i = 1; i < nstarted; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    for (i = 0; i < nthreads; i++)
+    {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    }
+
+    free(pool);
+    free(b);
+}
+
+
+/*
+ * processors_online:
+ *     Return the number of processors online, or 1 if it is not known.
+ */
+
+int
+processors_online(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return (n > 0) ? (int)n : 1;
+}
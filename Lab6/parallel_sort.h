@@ -0,0 +1,37 @@
+/*
+ * FILE: parallel_sort.h
+ */
+
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+
+/*
+ * A merge sort of an array of numbers that runs on several threads.
+ * The array is split in halves down to pieces of at most 'threshold'
+ * numbers, which are sorted with 'introsort'; the sorted pieces are then
+ * merged pairwise, each merge split again into independent parts by
+ * binary search.  Every split is a task that idle threads can steal, so
+ * all the threads keep busy until the end.
+ */
+
+/* Arrays no longer than this are sorted on one thread by default. */
+#define PARALLEL_SORT_THRESHOLD 65536L
+
+/* Most threads a sort will use. */
+#define MAX_SORT_THREADS 256
+
+
+/*
+ * Sort 'n' numbers in place on 'nthreads' threads, using a buffer as
+ * large as the array.  Pieces of up to 'threshold' numbers are sorted or
+ * merged without splitting them further.  With one thread, with no more
+ * than 'threshold' numbers, or if the buffer or the threads cannot be
+ * had, this is just 'introsort'.
+ */
+void parallel_sort(int *a, long n, int nthreads, long threshold);
+
+/* Return the number of processors online, or 1 if it is not known. */
+int processors_online(void);
+
+#endif  /* PARALLEL_SORT_H */
@@ -4,49 +4,167 @@
 #include <stdlib.h>
 #include "memcheck.h"
 #include "linked_list.h"
+#include "array_sort.h"
+#include "parallel_sort.h"
+#include "int_io.h"
+#include "external_sort.h"
 #define DEBUG 0
 
 /* 
  * The sorter function sorts an arbitrary number of integers and prints them in 
  *     increasing order, based on the quicksort algorithm. 
- *     Arguments: integers to be sorted, [-q]
+ *     Arguments: integers to sort, [-q], [-l], [-m], [-p], [-j threads],
+ *         [-r], [-x], [-M megabytes], [-f file], [-B]
  *     Returns: Printed list of integers in increasing order
  */
 
 
 node *quicksort(node *list);
+node *quicksort_with_tail(node *list, node **tail);
+void sort_externally(FILE *fp, char *input, int quiet, int binary,
+                     long memory);
 
 
 int main(int argc, char *argv[])
 {
     int i;
     int quiet = 0;
-    int list_length = 0;
+    int use_list = 0;
+    int merge = 0;
+    int parallel = 0;
+    int radix = 0;
+    int nthreads = 0;
+    int binary = 0;
+    int external = 0;
+    long memory = EXTERNAL_SORT_MEMORY;
+    long list_length;
+    long n;
 
     node *sorted_list;        /* pointer to the list */
     node *list;        /* pointer to the list */
     node *temp;        /* temporary pointer to node */
+    node *item;
+    node_pool *pool;   /* where the nodes come from */
+    int_array numbers; /* the numbers, from the arguments and the file */
+    char *input;       /* the file to read numbers from, if any */
+    FILE *fp;
     list = NULL;       /* NULL represents the empty list. */
+    input = NULL;
+    init_int_array(&numbers);
 
     /*
      * We will analyze the command line input by checking for -q tags, 
-     *     create new node in a linked list for each number.
-     *     `-q` indicates the program will not print any output
+     *     and collect the numbers in an array.
+     *     `-q` indicates the program will not print any output,
+     *     `-l` sorts a linked list with the quicksort instead,
+     *     `-m` sorts a linked list with the merge sort,
+     *     `-p` sorts the array on all processors,
+     *     `-j` sets the number of threads for `-p`,
+     *     `-r` sorts the array with the radix sort,
+     *     `-x` sorts the file with the external sort instead, which
+     *         keeps within `-M` megabytes of memory however large the
+     *         file is,
+     *     `-f` reads more numbers from a file, or from the standard
+     *         input if the file is `-`, and
+     *     `-B` reads and writes the numbers as 4-byte binary ints.
      */
     for (i = 1; i < argc; i++)
     {
         if (strcmp(argv[i], "-q") == 0)
         {
             quiet = 1;
-        } 
+        }
+        else if (strcmp(argv[i], "-l") == 0)
+        {
+            use_list = 1;
+        }
+        else if (strcmp(argv[i], "-m") == 0)
+        {
+            use_list = 1;
+            merge = 1;
+        }
+        else if (strcmp(argv[i], "-p") == 0)
+        {
+            parallel = 1;
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            nthreads = atoi(argv[++i]);
+            parallel = 1;
+        }
+        else if (strcmp(argv[i], "-r") == 0)
+        {
+            radix = 1;
+        }
+        else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+            input = argv[++i];
+        }
+        else if (strcmp(argv[i], "-x") == 0)
+        {
+            external = 1;
+        }
+        else if (strcmp(argv[i], "-M") == 0 && i + 1 < argc)
+        {
+            memory = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-B") == 0)
+        {
+            binary = 1;
+        }
         else
         {
-            temp = create_node(atoi(argv[i]), list);
-            /* Set the 'list' pointer to point to the new node. */
-            list = temp;
-            list_length++;
-        }        
+            add_int(&numbers, atoi(argv[i]));
+        }
+    }
+
+    /*
+     * The external sort takes its numbers from a file only, and prints
+     *     them as it merges them, without keeping them in `numbers`.
+     */
+    if (external)
+    {
+        if (input == NULL || numbers.length > 0 || memory <= 0)
+        {
+            fprintf(
+                stderr,
+                "usage: %s [-q] [-B] [-M megabytes] -x -f file\n",
+                argv[0]
+            );
+            exit(1);
+        }
+    }
+
+    /* Reading the file in one go, after the numbers in the arguments. */
+    if (input != NULL)
+    {
+        fp = (strcmp(input, "-") == 0) ? stdin : fopen(input, "rb");
+        if (fp == NULL)
+        {
+            fprintf(stderr, "Error! Cannot open %s!\n", input);
+            exit(1);
+        }
+        if (external)
+        {
+            sort_externally(fp, input, quiet, binary, memory);
+        }
+        else if (read_ints(fp, binary, &numbers) != 0)
+        {
+            fprintf(stderr, "Error! %s does not hold only numbers!\n",
+                    (fp == stdin) ? "The standard input" : input);
+            exit(1);
+        }
+        if (fp != stdin)
+        {
+            fclose(fp);
+        }
     }
+    if (external)
+    {
+        print_memory_leaks();
+        return 0;
+    }
+    list_length = numbers.length;
 
     /*
      * Checking that there is at least 1 input number. Otherwise,
@@ -56,142 +174,247 @@ int main(int argc, char *argv[])
     {
         fprintf(
             stderr,
-            "usage: %s[-q] number1 [number2 ...]\n",
+            "usage: %s [-q] [-l] [-m] [-p] [-j threads] [-r] [-B] "
+            "[-f file] number1 [number2 ...]\n"
+            "       %s [-q] [-B] [-M megabytes] -x -f file\n",
+            argv[0],
             argv[0]
         );
         exit(1);
     }
 
-    /* Sorting the list with the quicksort algorithm. */
+    /*
+     * Sorting the array with the introsort, which is much faster than
+     *     sorting a list.  With `-l` or `-m` the numbers are put in a
+     *     linked list instead, which is sorted with the quicksort
+     *     algorithm, or with the merge sort, which stays O(N log N) on
+     *     sorted or reversed input.  All of them, and the parallel and
+     *     radix sorts, give exactly the same output.
+     */
 
-    sorted_list = quicksort(list);
+    if (use_list == 0)
+    {
+        if (radix)
+        {
+            radix_sort_ints(numbers.data, list_length);
+        }
+        else if (parallel)
+        {
+            if (nthreads <= 0)
+            {
+                nthreads = processors_online();
+            }
+            parallel_sort(numbers.data, list_length, nthreads,
+                          PARALLEL_SORT_THRESHOLD);
+        }
+        else
+        {
+            introsort(numbers.data, list_length);
+        }
+    }
+    else
+    {
+        /* Building the list from the back keeps the numbers in order. */
+        pool = create_node_pool();
+        for (n = list_length - 1; n >= 0; n--)
+        {
+            temp = pool_create_node(pool, numbers.data[n], list);
+            /* Set the 'list' pointer to point to the new node. */
+            list = temp;
+        }
 
-    /* Printing the ordered input array of numbers from lowest to highest. */
+        if (merge)
+        {
+            sorted_list = merge_sort_list(list);
+            assert(is_sorted(sorted_list));
+        }
+        else
+        {
+            sorted_list = quicksort(list);
+        }
+
+        /*
+         * Copying the sorted numbers back into the array, so that every
+         *     sort prints the same way.  The sort reuses the nodes of
+         *     `list`, and all of them came from the pool.
+         */
+        n = 0;
+        for (item = sorted_list; item != NULL; item = item->next)
+        {
+            numbers.data[n++] = item->data;
+        }
+        free_node_pool(pool);
+    }
+    assert(ints_sorted(numbers.data, list_length));
 
-    if (quiet == 0)
+    /* Printing the ordered numbers from lowest to highest. */
+    if (quiet == 0 && write_ints(stdout, numbers.data, list_length,
+                                 binary) != 0)
     {
-        print_list(sorted_list);
+        fprintf(stderr, "Error! Cannot write the sorted numbers!\n");
+        exit(1);
     }
 
     /* Freeing the used memory and checking for memory leaks. */
-    free_list(list);
-    free_list(sorted_list);
+    free_int_array(&numbers);
     print_memory_leaks();
     
     return 0;    
 }
 
-/* 
- * This function uses the efficient quicksort algorithm on a linked list.
- *     From the starting list and a given value of the list, the list is 
- *     divided into two sub-lists containing smaller and larger
- *     values than the starting given value; and those list are sorted 
- *     recursively.
+/*
+ * This function sorts a linked list with the quicksort algorithm, in
+ *     place.  The nodes are relinked rather than copied, so no memory is
+ *     allocated or freed and the input list is used up.
  *     Arguments: list to be sorted.
- *     Returns: Pointer to new sorted list.
+ *     Returns: Pointer to the sorted list.
  */
 
 node *quicksort(node *list)
 {
-    node *start;
-    node *list_small; 
+    node *sorted_list;
+    node *tail;
+
+    sorted_list = quicksort_with_tail(list, &tail);
+
+    /*
+     * Checking that the list is sorted correctly before returning.
+     */
+    assert(is_sorted(sorted_list));
+
+    return sorted_list;
+}
+
+/*
+ * This function does the work of `quicksort`.  The nodes are split into
+ *     three lists with values smaller than, equal to and larger than the
+ *     value of the first node, each kept with a tail pointer so that
+ *     nodes and lists are joined in constant time.  Only the shorter of
+ *     the smaller and larger lists is sorted recursively; the loop
+ *     carries on with the other, so the recursion is never deeper than
+ *     about log2 of the length of the list.
+ *     Arguments: list to be sorted, and where to store its last node.
+ *     Returns: Pointer to the sorted list.
+ */
+
+node *quicksort_with_tail(node *list, node **tail)
+{
+    node *front;          /* sorted nodes that go before `list` */
+    node *front_tail;
+    node *back;           /* sorted nodes that go after `list` */
+    node *back_tail;
+    node *list_small;
+    node *small_tail;
+    node *list_equal;
+    node *equal_tail;
     node *list_large;
-    node *prev;
-    node *curr; 
-    node *sorted_list_small;
-    node *sorted_list_large;
-    node *sorted_list_temp;
+    node *large_tail;
+    node *curr;
+    node *next;
     node *sorted_list;
+    node *sorted_tail;
 
     int pivot;
-    int curr_data;
-
-    /* If list is empty or 1 node, list is fully sorted.  */
-    if (list == NULL || list -> next == NULL)
-    {
-        return copy_list(list);
-    }
+    int n_small;
+    int n_large;
 
-    /* Creating a copy of the first node of the list. */
-    start = create_node(list->data, NULL);
-    
-    /* Current value of the first node and next node to compare to. */
-    pivot = list->data;
-    curr = list->next;
-    
-    /* 
-     * Creating two lists from the original, one with values smaller than the
-     * value of the first node and another large one with values equal or 
-     * larger than the value of the original node `pivot`.
-     */
-    list_small = NULL;
-    list_large = NULL;
+    front = NULL;
+    front_tail = NULL;
+    back = NULL;
+    back_tail = NULL;
 
-    while (curr != NULL)
-    {   
-        curr_data = curr->data;
+    /* A list that is empty or has 1 node is fully sorted. */
+    while (list != NULL && list->next != NULL)
+    {
+        /* Splitting the list around the value of its first node. */
+        pivot = list->data;
+        list_small = small_tail = NULL;
+        list_equal = equal_tail = NULL;
+        list_large = large_tail = NULL;
+        n_small = 0;
+        n_large = 0;
 
-        /* 
-         * Creating the large or equal list and copying into it the appropriate
-         * values, starting a new list or linking to the start of the existing 
-         * `list_large`. 
-         */
-        if (curr_data >= pivot)
+        for (curr = list; curr != NULL; curr = next)
         {
-            if (list_large == NULL)
+            next = curr->next;
+            curr->next = NULL;
+
+            if (curr->data < pivot)
             {
-                list_large = create_node(curr_data, NULL);
+                join_lists(&list_small, &small_tail, curr, curr);
+                n_small++;
             }
-            else 
-            {   
-                prev = create_node(curr_data, list_large);
-                list_large = prev;
+            else if (curr->data > pivot)
+            {
+                join_lists(&list_large, &large_tail, curr, curr);
+                n_large++;
+            }
+            else
+            {
+                join_lists(&list_equal, &equal_tail, curr, curr);
             }
         }
-        /* 
-         * Creating the smaller list and copying into it the appropriate
-         * values, starting a new list or linking to the start of the existing 
-         * `list_small`. 
-         */
+
+        if (n_small <= n_large)
+        {
+            /* Small values, then equal ones, go at the end of `front`. */
+            list_small = quicksort_with_tail(list_small, &small_tail);
+            join_lists(&front, &front_tail, list_small, small_tail);
+            join_lists(&front, &front_tail, list_equal, equal_tail);
+            list = list_large;
+        }
         else
         {
-            if (list_small == NULL)
-            {
-                list_small = create_node(curr_data, NULL);
-            }
-            else 
-            {   
-                prev = create_node(curr_data, list_small);
-                list_small = prev;
-            }
+            /* Equal values, then large ones, go at the start of `back`. */
+            list_large = quicksort_with_tail(list_large, &large_tail);
+            join_lists(&list_equal, &equal_tail, list_large, large_tail);
+            join_lists(&list_equal, &equal_tail, back, back_tail);
+            back = list_equal;
+            back_tail = equal_tail;
+            list = list_small;
         }
-        curr = curr->next;
     }
 
-    /* 
-     * Recursively sorting the two lists with the quicksort function, and
-     *    appending them to the final sorted list: smaller than first
-     *    node, copy of the first node, and larger or equal to the first
-     *    node. 
-     */
-    sorted_list_small = quicksort(list_small);
-    sorted_list_large = quicksort(list_large);
-    
-    sorted_list_temp = append_lists(start, sorted_list_large);
-    sorted_list = append_lists(sorted_list_small, sorted_list_temp);
+    sorted_list = NULL;
+    sorted_tail = NULL;
+    join_lists(&sorted_list, &sorted_tail, front, front_tail);
+    join_lists(&sorted_list, &sorted_tail, list, list);
+    join_lists(&sorted_list, &sorted_tail, back, back_tail);
 
-    /* Freeing all the memory used in all the created lists. */
-    free(start);
-    free_list(list_small);
-    free_list(list_large);
-    free_list(sorted_list_small);
-    free_list(sorted_list_large);
-    free_list(sorted_list_temp);
+    *tail = sorted_tail;
+    return sorted_list;
+}
 
-    /*
-     * Checking that the list is sorted correctly before returning.
-     */
-    assert(is_sorted(sorted_list));
-    
-    return sorted_list; 
-}
\ No newline at end of file
+/*
+ * This function sorts the numbers of a file with the external sort and
+ *     prints them, unless `quiet` is set.  At most about `memory`
+ *     megabytes are used, so the file can be larger than the memory.
+ *     Arguments: the open file, its name, the flags and the megabytes.
+ *     Returns: Nothing; it exits on an error.
+ */
+
+void sort_externally(FILE *fp, char *input, int quiet, int binary,
+                     long memory)
+{
+    int result;
+
+    result = external_sort(fp, quiet ? NULL : stdout, binary,
+                           memory << 20);
+
+    if (result == EXTERNAL_SORT_BAD_INPUT)
+    {
+        fprintf(stderr, "Error! %s does not hold only numbers!\n",
+                (fp == stdin) ? "The standard input" : input);
+        exit(1);
+    }
+    if (result == EXTERNAL_SORT_WRITE_ERROR)
+    {
+        fprintf(stderr, "Error! Cannot write the sorted numbers!\n");
+        exit(1);
+    }
+    if (result == EXTERNAL_SORT_TEMP_ERROR)
+    {
+        fprintf(stderr, "Error! Cannot write the temporary files!\n");
+        exit(1);
+    }
+}
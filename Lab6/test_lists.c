@@ -0,0 +1,453 @@
+/*
+ * FILE: test_lists.c
+ *     Test of the linked list functions that the sorter does not use,
+ *     or does not use on every path.  Each is run on empty, short and
+ *     long lists, and every result is checked against the numbers it
+ *     should hold.  The node pool is checked to reuse the nodes given
+ *     back to it before allocating more blocks, and the unrolled list to
+ *     keep its nodes full.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "memcheck.h"
+#include "linked_list.h"
+#include "unrolled_list.h"
+
+/* Lists of many blocks of the node pool. */
+#define POOL_NODES (10 * NODE_POOL_BLOCK + 7)
+
+/*
+ * Long enough that a function recursing once per node would overflow an
+ * 8 MB stack, and short enough for memcheck to track quickly.
+ */
+#define LONG_LIST 300000L
+
+
+void fail(char *what);
+unsigned long next_random(void);
+void check_list(node *list, int *expect, long n, char *what);
+int *make_numbers(long n);
+node *make_list(int *numbers, long n);
+void check_tail(node *list, node *tail, char *what);
+void test_plain(long n1, long n2);
+int count_blocks(node_pool *pool);
+void test_pool(void);
+int compare_ints(const void *a, const void *b);
+unrolled_list *make_unrolled_list(int *numbers, long n);
+void check_unrolled(unrolled_list *list, int *expect, long n,
+                    int partial_first, char *what);
+void test_unrolled(long n1, long n2);
+
+
+unsigned long random_state = 2463534242UL;
+
+
+void fail(char *what)
+{
+    fprintf(stderr, "List test failed: %s!\n", what);
+    exit(1);
+}
+
+
+/* Fail unless 'list' holds exactly the 'n' numbers of 'expect'. */
+void check_list(node *list, int *expect, long n, char *what)
+{
+    long i;
+
+    for (i = 0; list != NULL; i++, list = list->next)
+    {
+        if (i >= n || list->data != expect[i])
+        {
+            fail(what);
+        }
+    }
+
+    if (i != n)
+    {
+        fail(what);
+    }
+}
+
+
+/* 32-bit xorshift random number generator. */
+unsigned long next_random(void)
+{
+    random_state ^= (random_state << 13) & 0xffffffffUL;
+    random_state ^= random_state >> 17;
+    random_state ^= (random_state << 5) & 0xffffffffUL;
+    return random_state;
+}
+
+
+/* Return 'n' random numbers; one more is allocated, so 'n' may be 0. */
+int *make_numbers(long n)
+{
+    int *numbers = (int *)malloc((n + 1) * sizeof(int));
+    long i;
+
+    if (numbers == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        numbers[i] = (int)(next_random() % 1000000);
+    }
+    return numbers;
+}
+
+
+/* Return a list of the 'n' numbers, in order. */
+node *make_list(int *numbers, long n)
+{
+    node *list = NULL;
+    long i;
+
+    for (i = n - 1; i >= 0; i--)
+    {
+        list = create_node(numbers[i], list);
+    }
+    return list;
+}
+
+
+/* Fail unless 'tail' is the last node of 'list', or NULL if it is empty. */
+void check_tail(node *list, node *tail, char *what)
+{
+    while (list != NULL && list->next != NULL)
+    {
+        list = list->next;
+    }
+
+    if (list != tail)
+    {
+        fail(what);
+    }
+}
+
+
+/*
+ * Run the copying, appending, joining and reversing functions on lists
+ * of 'n1' and 'n2' numbers.  The functions that copy must leave their
+ * inputs as they were, and since every result is freed before the
+ * inputs, memcheck catches a result that shares their nodes.
+ */
+void test_plain(long n1, long n2)
+{
+    node *list1;
+    node *list2;
+    node *result;
+    node *tail;
+    node *copy2;
+    node *tail2;
+    int *numbers;
+    int *backwards;
+    long i;
+
+    /* 'numbers' holds those of the first list and then the second. */
+    numbers = make_numbers(n1 + n2);
+    backwards = make_numbers(n1);
+    for (i = 0; i < n1; i++)
+    {
+        backwards[i] = numbers[n1 - 1 - i];
+    }
+    list1 = make_list(numbers, n1);
+    list2 = make_list(numbers + n1, n2);
+
+    result = copy_list(list1);
+    check_list(result, numbers, n1, "copy_list is wrong");
+    free_list(result);
+
+    result = copy_list_with_tail(list1, &tail);
+    check_list(result, numbers, n1, "copy_list_with_tail is wrong");
+    check_tail(result, tail, "copy_list_with_tail gave the wrong tail");
+    free_list(result);
+
+    result = append_lists(list1, list2);
+    check_list(result, numbers, n1 + n2, "append_lists is wrong");
+    free_list(result);
+
+    result = reverse_list(list1);
+    check_list(result, backwards, n1, "reverse_list is wrong");
+    free_list(result);
+
+    check_list(list1, numbers, n1, "a copying function changed its input");
+    check_list(list2, numbers + n1, n2,
+               "a copying function changed its input");
+
+    list1 = reverse_list_in_place(list1);
+    check_list(list1, backwards, n1, "reverse_list_in_place is wrong");
+    list1 = reverse_list_in_place(list1);
+    check_list(list1, numbers, n1, "reversing twice is wrong");
+
+    /* Join copies of both lists, then both lists themselves. */
+    result = copy_list_with_tail(list1, &tail);
+    copy2 = copy_list_with_tail(list2, &tail2);
+    join_lists(&result, &tail, copy2, tail2);
+    check_list(result, numbers, n1 + n2, "join_lists is wrong");
+    check_tail(result, tail, "join_lists gave the wrong tail");
+    free_list(result);
+
+    result = append_lists_in_place(list1, list2);
+    check_list(result, numbers, n1 + n2, "append_lists_in_place is wrong");
+    free_list(result);
+
+    free(numbers);
+    free(backwards);
+}
+
+
+/* Return the number of blocks 'pool' has allocated. */
+int count_blocks(node_pool *pool)
+{
+    node_block *block;
+    int count = 0;
+
+    for (block = pool->blocks; block != NULL; block = block->next)
+    {
+        count++;
+    }
+    return count;
+}
+
+
+/*
+ * Build a list from a node pool and copy it in the same pool.  Give a
+ * node and then the whole copy back, and check that making them again
+ * reuses the nodes given back instead of allocating new blocks.
+ */
+void test_pool(void)
+{
+    node_pool *pool;
+    node *list;
+    node *copy;
+    node *item;
+    node *other;
+    node *first;
+    int *numbers;
+    int blocks;
+    int gaps;
+    long i;
+
+    numbers = make_numbers(POOL_NODES);
+    pool = create_node_pool();
+
+    if (pool_copy_list(pool, NULL) != NULL || count_blocks(pool) != 0)
+    {
+        fail("copying an empty list made nodes");
+    }
+    pool_free_list(pool, NULL);
+
+    list = NULL;
+    for (i = POOL_NODES - 1; i >= 0; i--)
+    {
+        list = pool_create_node(pool, numbers[i], list);
+    }
+    check_list(list, numbers, POOL_NODES, "a pool list is wrong");
+
+    /* A copy from fresh blocks is in order in memory, block by block. */
+    blocks = count_blocks(pool);
+    copy = pool_copy_list(pool, list);
+    check_list(copy, numbers, POOL_NODES, "a pool copy is wrong");
+
+    gaps = 0;
+    for (item = copy, other = list; item != NULL;
+         item = item->next, other = other->next)
+    {
+        if (item == other)
+        {
+            fail("a pool copy shares nodes with its list");
+        }
+        if (item->next != NULL && item->next != item + 1)
+        {
+            gaps++;
+        }
+    }
+    if (gaps > count_blocks(pool) - blocks)
+    {
+        fail("a pool copy is out of order in memory");
+    }
+
+    /* A node given back is the next one handed out. */
+    first = list;
+    list = list->next;
+    pool_free_node(pool, first);
+    list = pool_create_node(pool, numbers[0], list);
+    if (list != first)
+    {
+        fail("a node given back was not reused");
+    }
+    check_list(list, numbers, POOL_NODES, "a rebuilt pool list is wrong");
+
+    /* Copying again takes the nodes of the old copy, and no blocks. */
+    blocks = count_blocks(pool);
+    pool_free_list(pool, copy);
+    copy = pool_copy_list(pool, list);
+    if (count_blocks(pool) != blocks || pool->free_nodes != NULL)
+    {
+        fail("a copy did not reuse the nodes given back");
+    }
+    check_list(copy, numbers, POOL_NODES, "a reused pool copy is wrong");
+
+    free_node_pool(pool);
+    free(numbers);
+}
+
+
+/* Comparison function for `qsort`: increasing order. */
+int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *) a;
+    int y = *(const int *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/* Return an unrolled list of the 'n' numbers, in order. */
+unrolled_list *make_unrolled_list(int *numbers, long n)
+{
+    unrolled_list *list = create_unrolled_list();
+    long i;
+
+    for (i = 0; i < n; i++)
+    {
+        unrolled_push_back(list, numbers[i]);
+    }
+    return list;
+}
+
+
+/*
+ * Fail unless the unrolled 'list' holds exactly the 'n' numbers of
+ * 'expect', its length and tail are right, and every node is full but
+ * the last, or the first if 'partial_first'.
+ */
+void check_unrolled(unrolled_list *list, int *expect, long n,
+                    int partial_first, char *what)
+{
+    unrolled_node *u;
+    long i = 0;
+    int j;
+
+    for (u = list->head; u != NULL; u = u->next)
+    {
+        if (u->count <= 0 || u->count > UNROLLED_NODE_INTS)
+        {
+            fail(what);
+        }
+        if (u->count < UNROLLED_NODE_INTS
+            && (partial_first ? u != list->head : u->next != NULL))
+        {
+            fail(what);
+        }
+        for (j = 0; j < u->count; j++, i++)
+        {
+            if (i >= n || u->data[j] != expect[i])
+            {
+                fail(what);
+            }
+        }
+        if (u->next == NULL && u != list->tail)
+        {
+            fail(what);
+        }
+    }
+
+    if (i != n || list->length != n || (n == 0 && list->tail != NULL))
+    {
+        fail(what);
+    }
+}
+
+
+/*
+ * Build, copy, append, reverse and sort unrolled lists of 'n1' and 'n2'
+ * numbers.  Copying and appending must leave their inputs as they were.
+ */
+void test_unrolled(long n1, long n2)
+{
+    unrolled_list *list1;
+    unrolled_list *list2;
+    unrolled_list *result;
+    int *numbers;
+    int *backwards;
+    long i;
+
+    numbers = make_numbers(n1 + n2);
+    backwards = make_numbers(n1);
+    for (i = 0; i < n1; i++)
+    {
+        backwards[i] = numbers[n1 - 1 - i];
+    }
+    list1 = make_unrolled_list(numbers, n1);
+    list2 = make_unrolled_list(numbers + n1, n2);
+    check_unrolled(list1, numbers, n1, 0, "unrolled_push_back is wrong");
+
+    result = copy_unrolled_list(list1);
+    check_unrolled(result, numbers, n1, 0, "copy_unrolled_list is wrong");
+    free_unrolled_list(result);
+
+    result = append_unrolled_lists(list1, list2);
+    check_unrolled(result, numbers, n1 + n2, 0,
+                   "append_unrolled_lists is wrong");
+    free_unrolled_list(result);
+
+    check_unrolled(list1, numbers, n1, 0,
+                   "a copying function changed its input");
+    check_unrolled(list2, numbers + n1, n2, 0,
+                   "a copying function changed its input");
+
+    reverse_unrolled_list(list1);
+    check_unrolled(list1, backwards, n1, 1, "reverse_unrolled_list is wrong");
+    reverse_unrolled_list(list1);
+    check_unrolled(list1, numbers, n1, 0, "reversing twice is wrong");
+
+    /* An unsorted list must be seen as such, and then sorted. */
+    qsort(backwards, n1, sizeof(int), compare_ints);
+    for (i = 1; i < n1 && numbers[i - 1] <= numbers[i]; i++)
+    {
+        ;
+    }
+    if (unrolled_is_sorted(list1) != (i >= n1))
+    {
+        fail("unrolled_is_sorted is wrong");
+    }
+    sort_unrolled_list(list1);
+    check_unrolled(list1, backwards, n1, 0, "sort_unrolled_list is wrong");
+    if (!unrolled_is_sorted(list1))
+    {
+        fail("unrolled_is_sorted missed a sorted list");
+    }
+
+    free_unrolled_list(list1);
+    free_unrolled_list(list2);
+    free(numbers);
+    free(backwards);
+}
+
+
+int main(void)
+{
+    test_plain(0, 0);
+    test_plain(0, 5);
+    test_plain(5, 0);
+    test_plain(1, 1);
+    test_plain(7, 13);
+    test_plain(LONG_LIST, LONG_LIST / 2);
+    test_pool();
+    test_unrolled(0, 0);
+    test_unrolled(0, 5);
+    test_unrolled(5, 0);
+    test_unrolled(1, 1);
+    test_unrolled(UNROLLED_NODE_INTS, UNROLLED_NODE_INTS);
+    test_unrolled(7, 20);
+    test_unrolled(LONG_LIST, LONG_LIST / 2);
+
+    print_memory_leaks();
+    printf("List test succeeded!\n");
+    return 0;
+}
@@ -0,0 +1,381 @@
+/*
+ * FILE: unrolled_list.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "memcheck.h"
+#include "unrolled_list.h"
+
+/* Runs of this many numbers are insertion sorted before merging. */
+#define SORT_RUN 16
+
+
+void add_ints(unrolled_list *list, int *data, int n);
+void merge_sort_ints(int *a, int *tmp, long n);
+
+
+/*
+ * create_unrolled_list:
+ *     Make an empty unrolled list.
+ */
+
+unrolled_list *
+create_unrolled_list(void)
+{
+    unrolled_list *list = (unrolled_list *)malloc(sizeof(unrolled_list));
+
+    if (list == NULL)
+    {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    list->head = NULL;
+    list->tail = NULL;
+    list->length = 0;
+
+    return list;
+}
+
+
+/*
+ * free_unrolled_list:
+ *     Free an unrolled list and all its nodes.
+ */
+
+void
+free_unrolled_list(unrolled_list *list)
+{
+    unrolled_node *n;
+
+    while (list->head != NULL)
+    {
+        n = list->head;
+        list->head = n->next;
+        free(n);
+    }
+
+    free(list);
+}
+
+
+/*
+ * add_ints:
+ *     Add 'n' numbers to the end of an unrolled list, filling up the
+ *     last node before starting new ones.
+ */
+
+void
+add_ints(unrolled_list *list, int *data, int n)
+{
+    unrolled_node *tail;
+    int room;
+
+    while (n > 0)
+    {
+        tail = list->tail;
+
+        if (tail == NULL || tail->count == UNROLLED_NODE_INTS)
+        {
+            tail = (unrolled_node *)malloc(sizeof(unrolled_node));
+
+            if (tail == NULL)
+            {
+                fprintf(stderr, "Fatal error: out of memory. "
+                        "Terminating program.\n");
+                exit(1);
+            }
+
+            tail->next = NULL;
+            tail->count = 0;
+
+            if (list->tail == NULL)
+            {
+                list->head = tail;
+            }
+            else
+            {
+                list->tail->next = tail;
+            }
+            list->tail = tail;
+        }
+
+        room = UNROLLED_NODE_INTS - tail->count;
+        if (room > n)
+        {
+            room = n;
+        }
+
+        memcpy(tail->data + tail->count, data, room * sizeof(int));
+        tail->count += room;
+        list->length += room;
+        data += room;
+        n -= room;
+    }
+}
+
+
+/*
+ * unrolled_push_back:
+ *     Add a number to the end of an unrolled list.
+ */
+
+void
+unrolled_push_back(unrolled_list *list, int data)
+{
+    unrolled_node *tail = list->tail;
+
+    /* The common case: there is room in the last node. */
+    if (tail != NULL && tail->count < UNROLLED_NODE_INTS)
+    {
+        tail->data[tail->count++] = data;
+        list->length++;
+    }
+    else
+    {
+        add_ints(list, &data, 1);
+    }
+}
+
+
+/*
+ * copy_unrolled_list:
+ *     Return a copy of an unrolled list, with all its nodes but the last
+ *     full.
+ */
+
+unrolled_list *
+copy_unrolled_list(unrolled_list *list)
+{
+    unrolled_list *new_list = create_unrolled_list();
+    unrolled_node *n;
+
+    for (n = list->head; n != NULL; n = n->next)
+    {
+        add_ints(new_list, n->data, n->count);
+    }
+
+    return new_list;
+}
+
+
+/*
+ * append_unrolled_lists:
+ *     Return a new list holding the numbers of 'list1' followed by
+ *     those of 'list2'.  The input lists are not altered.
+ */
+
+unrolled_list *
+append_unrolled_lists(unrolled_list *list1, unrolled_list *list2)
+{
+    unrolled_list *new_list = copy_unrolled_list(list1);
+    unrolled_node *n;
+
+    for (n = list2->head; n != NULL; n = n->next)
+    {
+        add_ints(new_list, n->data, n->count);
+    }
+
+    return new_list;
+}
+
+
+/*
+ * reverse_unrolled_list:
+ *     Reverse an unrolled list in place: the order of the nodes, and the
+ *     order of the numbers in each node.
+ */
+
+void
+reverse_unrolled_list(unrolled_list *list)
+{
+    unrolled_node *reversed = NULL;
+    unrolled_node *n;
+    unrolled_node *next;
+    int i, j, temp;
+
+    list->tail = list->head;
+
+    for (n = list->head; n != NULL; n = next)
+    {
+        for (i = 0, j = n->count - 1; i < j; i++, j--)
+        {
+            temp = n->data[i];
+            n->data[i] = n->data[j];
+            n->data[j] = temp;
+        }
+
+        next = n->next;
+        n->next = reversed;
+        reversed = n;
+    }
+
+    list->head = reversed;
+}
+
+
+/*
+ * print_unrolled_list:
+ *     Print the numbers of an unrolled list, one per line.
+ */
+
+void
+print_unrolled_list(unrolled_list *list)
+{
+    unrolled_node *n;
+    int i;
+
+    for (n = list->head; n != NULL; n = n->next)
+    {
+        for (i = 0; i < n->count; i++)
+        {
+            printf("%d\n", n->data[i]);
+        }
+    }
+}
+
+
+/*
+ * unrolled_is_sorted:
+ *     Return 1 if an unrolled list is sorted, otherwise 0.
+ */
+
+int
+unrolled_is_sorted(unrolled_list *list)
+{
+    unrolled_node *n;
+    int have_last = 0;
+    int last = 0;
+    int i;
+
+    for (n = list->head; n != NULL; n = n->next)
+    {
+        for (i = 0; i < n->count; i++)
+        {
+            if (have_last && last > n->data[i])  /* wrong order */
+            {
+                return 0;
+            }
+            last = n->data[i];
+            have_last = 1;
+        }
+    }
+
+    return 1;
+}
+
+
+/*
+ * merge_sort_ints:
+ *     Sort the array 'a' of 'n' numbers, using 'tmp' (also 'n' long) as
+ *     scratch space.  Runs of SORT_RUN numbers are insertion sorted,
+ *     then runs are merged pairwise, back and forth between the two
+ *     arrays, doubling in length each pass.
+ */
+
+void
+merge_sort_ints(int *a, int *tmp, long n)
+{
+    int *src = a;
+    int *dst = tmp;
+    int *swap;
+    long width, lo, mid, hi, i, j, k;
+    int value;
+
+    for (lo = 0; lo < n; lo += SORT_RUN)
+    {
+        hi = (lo + SORT_RUN < n) ? lo + SORT_RUN : n;
+        for (i = lo + 1; i < hi; i++)
+        {
+            value = a[i];
+            for (j = i; j > lo && a[j - 1] > value; j--)
+            {
+                a[j] = a[j - 1];
+            }
+            a[j] = value;
+        }
+    }
+
+    for (width = SORT_RUN; width < n; width *= 2)
+    {
+        for (lo = 0; lo < n; lo += 2 * width)
+        {
+            mid = (lo + width < n) ? lo + width : n;
+            hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+
+            /* Take from the left run on ties, so the sort is stable. */
+            i = lo;
+            j = mid;
+            for (k = lo; k < hi; k++)
+            {
+                if (i < mid && (j >= hi || src[i] <= src[j]))
+                {
+                    dst[k] = src[i++];
+                }
+                else
+                {
+                    dst[k] = src[j++];
+                }
+            }
+        }
+
+        swap = src;
+        src = dst;
+        dst = swap;
+    }
+
+    if (src != a)
+    {
+        memcpy(a, src, n * sizeof(int));
+    }
+}
+
+
+/*
+ * sort_unrolled_list:
+ *     Sort an unrolled list in place.  The numbers are gathered into an
+ *     array, sorted there, and written back into the same nodes.
+ */
+
+void
+sort_unrolled_list(unrolled_list *list)
+{
+    unrolled_node *n;
+    int *buffer;
+    long pos;
+
+    if (list->length < 2)
+    {
+        return;
+    }
+
+    buffer = (int *)malloc(2 * list->length * sizeof(int));
+
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "Fatal error: out of memory. "
+                "Terminating program.\n");
+        exit(1);
+    }
+
+    pos = 0;
+    for (n = list->head; n != NULL; n = n->next)
+    {
+        memcpy(buffer + pos, n->data, n->count * sizeof(int));
+        pos += n->count;
+    }
+
+    merge_sort_ints(buffer, buffer + list->length, list->length);
+
+    pos = 0;
+    for (n = list->head; n != NULL; n = n->next)
+    {
+        memcpy(n->data, buffer + pos, n->count * sizeof(int));
+        pos += n->count;
+    }
+
+    free(buffer);
+}
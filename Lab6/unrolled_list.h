@@ -0,0 +1,69 @@
+/*
+ * FILE: unrolled_list.h
+ */
+
+#ifndef UNROLLED_LIST_H
+#define UNROLLED_LIST_H
+
+
+/*
+ * An unrolled list is a linked list whose nodes each hold up to
+ * UNROLLED_NODE_INTS numbers in an array, so that walking the list
+ * reads whole cache lines of numbers instead of one number per node.
+ * With 8-byte pointers a node is exactly 64 bytes.  Building, copying
+ * and appending keep every node but the last full, so the numbers are
+ * stored densely; reversing moves the one partly used node to the front.
+ */
+
+#define UNROLLED_NODE_INTS 13
+
+typedef struct _unrolled_node
+{
+  struct _unrolled_node *next;      /* the next node in the chain */
+  int count;                        /* numbers used in 'data' */
+  int data[UNROLLED_NODE_INTS];
+} unrolled_node;
+
+typedef struct
+{
+  unrolled_node *head;
+  unrolled_node *tail;              /* for adding to the end quickly */
+  long length;                      /* numbers in the whole list */
+} unrolled_list;
+
+
+/* Make an empty unrolled list. */
+unrolled_list *create_unrolled_list(void);
+
+/* Free an unrolled list and all its nodes. */
+void free_unrolled_list(unrolled_list *list);
+
+/* Add a number to the end of an unrolled list. */
+void unrolled_push_back(unrolled_list *list, int data);
+
+/* Return a copy of an unrolled list. */
+unrolled_list *copy_unrolled_list(unrolled_list *list);
+
+/*
+ * Return a new list holding the numbers of 'list1' followed by those of
+ * 'list2'.  The input lists are not altered.
+ */
+unrolled_list *append_unrolled_lists(unrolled_list *list1,
+                                     unrolled_list *list2);
+
+/* Reverse an unrolled list in place. */
+void reverse_unrolled_list(unrolled_list *list);
+
+/* Print the numbers of an unrolled list, one per line. */
+void print_unrolled_list(unrolled_list *list);
+
+/* Return 1 if an unrolled list is sorted, otherwise 0. */
+int unrolled_is_sorted(unrolled_list *list);
+
+/*
+ * Sort an unrolled list in place with a merge sort.  Uses a buffer of
+ * twice as many numbers as the list.
+ */
+void sort_unrolled_list(unrolled_list *list);
+
+#endif  /* UNROLLED_LIST_H */
@@ -0,0 +1,739 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: bench.c
+ *     Benchmark of the word counting tables on synthetic key
+ *     distributions.  Every combination of table engine, key
+ *     distribution and corpus size is run in its own child process, so
+ *     each run's peak memory is its own, and the results are written as
+ *     a JSON array for regression tracking.
+ *
+ */
+
+/* Needed for clock_gettime, fork and getrusage under -ansi. */
+#define _POSIX_C_SOURCE 200112L
+#define _XOPEN_SOURCE 600
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "hash_table.h"
+#include "word_map.h"
+#include "memcheck.h"
+
+/* Chain or probe lengths 0 .. HIST_SIZE - 2, and HIST_SIZE - 1 or more. */
+#define HIST_SIZE STATS_HIST_SIZE
+
+/* Largest number of distinct words in a corpus. */
+#define MAX_VOCABULARY (1L << 20)
+
+/* Length of the shared prefix of the words in the long-key corpus. */
+#define LONG_PREFIX 96
+
+/* Letters permuted to make the words of the anagram corpus. */
+#define ANAGRAM_LETTERS "abcdefghijkl"
+
+#define MAX_RUNS 16
+
+
+/*
+ * The additive hash of hash_table.c without the reduction modulo NSLOTS,
+ * in the form expected by STRING_MAP_DEFINE_HASH.
+ */
+#define SUM_HASH(key, len, h)                                             \
+    do                                                                    \
+    {                                                                     \
+        const char *p_ = (key);                                           \
+                                                                          \
+        (h) = 0;                                                          \
+        while (*p_)                                                       \
+        {                                                                 \
+            (h) += (unsigned char) *p_++;                                 \
+        }                                                                 \
+        (len) = (size_t) (p_ - (key));                                    \
+    } while (0)
+
+STRING_MAP_DECLARE(sum_map, long)
+STRING_MAP_DEFINE_HASH(sum_map, long, SUM_HASH)
+
+
+/*
+ * Data structure definitions.
+ */
+
+/*
+ * A corpus: 'ntokens' word numbers indexing 'nwords' distinct words.
+ */
+
+typedef struct
+{
+    char **word;        /* the distinct words */
+    char *arena;        /* storage for the words */
+    long nwords;
+    int *token;         /* the text, as word numbers */
+    long ntokens;
+} corpus;
+
+/*
+ * Measurements of one run.  'len_hist' counts chain lengths per slot for
+ * the chained table and probe lengths per key for the open tables.
+ */
+
+typedef struct
+{
+    long distinct;
+    long nslots;
+    double insert_ns;   /* per token */
+    double lookup_ns;   /* per token */
+    long max_len;
+    double mean_len;
+    long len_hist[HIST_SIZE];
+    long checksum;      /* successful lookups, equal to 'ntokens' */
+} bench_result;
+
+/*
+ * A table engine: a name, the hash it uses and the function that runs
+ * it over a corpus.
+ */
+
+typedef struct
+{
+    char *name;
+    char *hash;
+    void (*run)(corpus *c, bench_result *r);
+} engine;
+
+/*
+ * A key distribution: a name and the function that makes a corpus.
+ */
+
+typedef struct
+{
+    char *name;
+    void (*make)(corpus *c);
+} distribution;
+
+
+/*
+ * Function prototypes.
+ */
+
+void usage(char *progname);
+unsigned long next_random(void);
+double now_ns(void);
+void *bench_alloc(size_t size);
+void make_corpus(corpus *c, long ntokens, long nwords, int word_length);
+void free_corpus(corpus *c);
+void make_zipf(corpus *c);
+void make_uniform(corpus *c);
+void make_anagram(corpus *c);
+void make_long(corpus *c);
+void add_length(bench_result *r, long len);
+void run_chain(corpus *c, bench_result *r);
+void run_open_fnv(corpus *c, bench_result *r);
+void run_open_sum(corpus *c, bench_result *r);
+int run_one(FILE *out, engine *e, distribution *d, long ntokens);
+
+
+engine engines[] =
+{
+    { "chain", "sum", run_chain },
+    { "open", "fnv", run_open_fnv },
+    { "open", "sum", run_open_sum }
+};
+
+distribution distributions[] =
+{
+    { "zipf", make_zipf },
+    { "uniform", make_uniform },
+    { "anagram", make_anagram },
+    { "long", make_long }
+};
+
+#define NENGINES        ((int) (sizeof(engines) / sizeof(engines[0])))
+#define NDISTRIBUTIONS  ((int) (sizeof(distributions) / \
+                                sizeof(distributions[0])))
+
+unsigned long random_state = 2463534242UL;
+
+
+void usage(char *progname)
+{
+    fprintf(stderr, "usage: %s [-n tokens]... [-e engine]... "
+                    "[-d distribution]... [-s seed] [-o file]\n"
+                    "       engines: chain, open (fnv and sum hashes)\n"
+                    "       distributions: zipf, uniform, anagram, long\n",
+            progname);
+}
+
+
+/* 32-bit xorshift random number generator. */
+unsigned long next_random(void)
+{
+    random_state ^= (random_state << 13) & 0xffffffffUL;
+    random_state ^= random_state >> 17;
+    random_state ^= (random_state << 5) & 0xffffffffUL;
+    return random_state;
+}
+
+
+/* Current time in nanoseconds. */
+double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+void *bench_alloc(size_t size)
+{
+    void *mem = malloc(size);
+
+    if (mem == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+    return mem;
+}
+
+
+/*** Corpora. ***/
+
+/*
+ * Allocate a corpus of 'ntokens' tokens over 'nwords' words of at most
+ * 'word_length' characters.
+ */
+void make_corpus(corpus *c, long ntokens, long nwords, int word_length)
+{
+    c->ntokens = ntokens;
+    c->nwords = nwords;
+    c->token = (int *) bench_alloc(ntokens * sizeof(int));
+    c->word = (char **) bench_alloc(nwords * sizeof(char *));
+    c->arena = (char *) bench_alloc(nwords * (word_length + 1));
+}
+
+
+void free_corpus(corpus *c)
+{
+    free(c->token);
+    free(c->word);
+    free(c->arena);
+}
+
+
+/* Number of distinct words for a corpus of 'ntokens' tokens. */
+static long vocabulary_size(long ntokens)
+{
+    long n = ntokens / 8;
+
+    if (n < 16)
+    {
+        n = 16;
+    }
+    return (n > MAX_VOCABULARY) ? MAX_VOCABULARY : n;
+}
+
+
+/* Write word number 'i' in base 26 ("a", "b", ... "ba", ...) to 'buf'. */
+static int number_word(char *buf, long i)
+{
+    char digits[16];
+    int n = 0;
+    int len = 0;
+
+    do
+    {
+        digits[n++] = (char) ('a' + i % 26);
+        i /= 26;
+    } while (i > 0);
+
+    while (n > 0)
+    {
+        buf[len++] = digits[--n];
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+
+/* Fill the words of 'c' with the base-26 numbers. */
+static void number_words(corpus *c)
+{
+    char *p = c->arena;
+    long i;
+
+    for (i = 0; i < c->nwords; i++)
+    {
+        c->word[i] = p;
+        p += number_word(p, i) + 1;
+    }
+}
+
+
+/* Zipf-distributed tokens: word i has probability proportional to 1/i. */
+void make_zipf(corpus *c)
+{
+    double *cdf;
+    double sum;
+    double u;
+    long lo;
+    long hi;
+    long mid;
+    long i;
+
+    make_corpus(c, c->ntokens, vocabulary_size(c->ntokens), 8);
+    number_words(c);
+
+    cdf = (double *) bench_alloc(c->nwords * sizeof(double));
+    sum = 0.0;
+    for (i = 0; i < c->nwords; i++)
+    {
+        sum += 1.0 / (i + 1);
+        cdf[i] = sum;
+    }
+
+    for (i = 0; i < c->ntokens; i++)
+    {
+        u = (next_random() / 4294967296.0) * sum;
+
+        /* Find the first word whose cumulative weight exceeds 'u'. */
+        lo = 0;
+        hi = c->nwords - 1;
+        while (lo < hi)
+        {
+            mid = (lo + hi) / 2;
+            if (cdf[mid] <= u)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        c->token[i] = (int) lo;
+    }
+
+    free(cdf);
+}
+
+
+/* Pick every token uniformly from the words of 'c'. */
+static void uniform_tokens(corpus *c)
+{
+    long i;
+
+    for (i = 0; i < c->ntokens; i++)
+    {
+        c->token[i] = (int) (next_random() % c->nwords);
+    }
+}
+
+
+/* Uniformly distributed tokens. */
+void make_uniform(corpus *c)
+{
+    make_corpus(c, c->ntokens, vocabulary_size(c->ntokens), 8);
+    number_words(c);
+    uniform_tokens(c);
+}
+
+
+/*
+ * Words that are all permutations of the same letters.  They have the
+ * same character sum, so an additive hash sends them all to one place.
+ */
+void make_anagram(corpus *c)
+{
+    char letters[sizeof(ANAGRAM_LETTERS)];
+    int nletters = (int) strlen(ANAGRAM_LETTERS);
+    char *p;
+    char temp;
+    long i;
+    long k;
+    int j;
+
+    make_corpus(c, c->ntokens, vocabulary_size(c->ntokens), nletters);
+
+    /* Word i is the i-th permutation, from the factorial digits of i. */
+    p = c->arena;
+    for (i = 0; i < c->nwords; i++)
+    {
+        strcpy(letters, ANAGRAM_LETTERS);
+        k = i;
+        for (j = 0; j < nletters; j++)
+        {
+            int pick = j + (int) (k % (nletters - j));
+
+            k /= nletters - j;
+            temp = letters[j];
+            letters[j] = letters[pick];
+            letters[pick] = temp;
+        }
+        c->word[i] = p;
+        strcpy(p, letters);
+        p += nletters + 1;
+    }
+
+    uniform_tokens(c);
+}
+
+
+/*
+ * Long words that only differ at the end, so that hashing and comparing
+ * keys dominate, and no key fits inline in a string map slot.
+ */
+void make_long(corpus *c)
+{
+    char *p;
+    long i;
+
+    make_corpus(c, c->ntokens, vocabulary_size(c->ntokens),
+                LONG_PREFIX + 16);
+
+    p = c->arena;
+    for (i = 0; i < c->nwords; i++)
+    {
+        c->word[i] = p;
+        memset(p, 'x', LONG_PREFIX);
+        p += LONG_PREFIX + number_word(p + LONG_PREFIX, i) + 1;
+    }
+
+    uniform_tokens(c);
+}
+
+
+/*** Engines. ***/
+
+/* Count one chain or probe length into the histogram of 'r'. */
+void add_length(bench_result *r, long len)
+{
+    r->len_hist[len < HIST_SIZE - 1 ? len : HIST_SIZE - 1]++;
+    if (len > r->max_len)
+    {
+        r->max_len = len;
+    }
+}
+
+
+/*
+ * The chained hash table, used the same way main.c uses it: every token
+ * is copied and the copy is handed to the table.
+ */
+void run_chain(corpus *c, bench_result *r)
+{
+    hash_table *ht;
+    hash_table_stats stats;
+    char *w;
+    char *copy;
+    double start;
+    long i;
+
+    ht = create_hash_table();
+
+    start = now_ns();
+    for (i = 0; i < c->ntokens; i++)
+    {
+        w = c->word[c->token[i]];
+        copy = (char *) malloc(strlen(w) + 1);
+        if (copy == NULL)
+        {
+            fprintf(stderr, "Error! Memory allocation failed!\n");
+            exit(1);
+        }
+        strcpy(copy, w);
+        set_value(ht, copy, get_value(ht, w) + 1);
+    }
+    r->insert_ns = (now_ns() - start) / c->ntokens;
+
+    start = now_ns();
+    for (i = 0; i < c->ntokens; i++)
+    {
+        r->checksum += (get_value(ht, c->word[c->token[i]]) > 0);
+    }
+    r->lookup_ns = (now_ns() - start) / c->ntokens;
+
+    /* Chain lengths; the mean is over nonempty chains. */
+    get_hash_table_stats(ht, &stats);
+    r->nslots = stats.nslots;
+    r->distinct = stats.entries;
+    r->max_len = stats.max_chain;
+    r->mean_len = stats.mean_chain;
+    memcpy(r->len_hist, stats.chain_hist, sizeof(r->len_hist));
+
+    free_hash_table(ht);
+}
+
+
+/*
+ * The open-addressing string maps.  The same code is expanded for each
+ * map type, because the maps are different types.  The probe length of a
+ * key is the number of slots a successful lookup visits.
+ */
+#define RUN_STRING_MAP(map, c, r)                                         \
+    do                                                                    \
+    {                                                                     \
+        map *m_;                                                          \
+        double start_;                                                    \
+        long i_;                                                          \
+        size_t s_;                                                        \
+        long len_;                                                        \
+        long total_ = 0;                                                  \
+                                                                          \
+        m_ = map##_create();                                              \
+                                                                          \
+        start_ = now_ns();                                                \
+        for (i_ = 0; i_ < (c)->ntokens; i_++)                             \
+        {                                                                 \
+            (*map##_insert(m_, (c)->word[(c)->token[i_]]))++;             \
+        }                                                                 \
+        (r)->insert_ns = (now_ns() - start_) / (c)->ntokens;              \
+                                                                          \
+        start_ = now_ns();                                                \
+        for (i_ = 0; i_ < (c)->ntokens; i_++)                             \
+        {                                                                 \
+            (r)->checksum += (map##_find(m_, (c)->word[(c)->token[i_]])   \
+                              != NULL);                                   \
+        }                                                                 \
+        (r)->lookup_ns = (now_ns() - start_) / (c)->ntokens;              \
+                                                                          \
+        (r)->nslots = (long) m_->nslots;                                  \
+        (r)->distinct = (long) m_->size;                                  \
+        for (s_ = map##_next(m_, 0); s_ < m_->nslots;                     \
+             s_ = map##_next(m_, s_ + 1))                                 \
+        {                                                                 \
+            len_ = (long) ((s_ - m_->slot[s_].hash) & (m_->nslots - 1))   \
+                   + 1;                                                   \
+            add_length(r, len_);                                          \
+            total_ += len_;                                               \
+        }                                                                 \
+        (r)->mean_len = (r)->distinct ? (double) total_ / (r)->distinct   \
+                                      : 0.0;                              \
+                                                                          \
+        map##_free(m_);                                                   \
+    } while (0)
+
+
+void run_open_fnv(corpus *c, bench_result *r)
+{
+    RUN_STRING_MAP(word_map, c, r);
+}
+
+
+void run_open_sum(corpus *c, bench_result *r)
+{
+    RUN_STRING_MAP(sum_map, c, r);
+}
+
+
+/*** Driver. ***/
+
+/*
+ * Run engine 'e' on a new corpus from distribution 'd' and write the
+ * result to 'out' as a JSON object.  Called in a child process.  Return
+ * 0, or 1 if the table did not find every token it was given.
+ */
+int run_one(FILE *out, engine *e, distribution *d, long ntokens)
+{
+    corpus c;
+    bench_result r;
+    struct rusage usage;
+    int i;
+
+    memset(&r, 0, sizeof(r));
+    c.ntokens = ntokens;
+    d->make(&c);
+    e->run(&c, &r);
+
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(out, "  {\"engine\": \"%s\", \"hash\": \"%s\", "
+                 "\"distribution\": \"%s\", \"tokens\": %ld, "
+                 "\"distinct\": %ld,\n", e->name, e->hash, d->name,
+            ntokens, r.distinct);
+    fprintf(out, "   \"slots\": %ld, \"load_factor\": %.4f, "
+                 "\"insert_ns_per_op\": %.2f, \"lookup_ns_per_op\": %.2f,\n",
+            r.nslots, (double) r.distinct / r.nslots, r.insert_ns,
+            r.lookup_ns);
+    fprintf(out, "   \"length_kind\": \"%s\", \"max_length\": %ld, "
+                 "\"mean_length\": %.3f,\n",
+            strcmp(e->name, "chain") == 0 ? "chain" : "probe",
+            r.max_len, r.mean_len);
+    fprintf(out, "   \"length_histogram\": [");
+    for (i = 0; i < HIST_SIZE; i++)
+    {
+        fprintf(out, "%s%ld", i ? ", " : "", r.len_hist[i]);
+    }
+    fprintf(out, "],\n   \"peak_rss_kb\": %ld, \"checksum_ok\": %s}",
+            usage.ru_maxrss, r.checksum == ntokens ? "true" : "false");
+
+    free_corpus(&c);
+
+    if (r.checksum != ntokens)
+    {
+        fprintf(stderr, "Error! %s/%s found %ld of %ld tokens!\n",
+                e->name, e->hash, r.checksum, ntokens);
+        return 1;
+    }
+    return 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    long sizes[MAX_RUNS];
+    int use_engine[MAX_RUNS];
+    int use_distribution[MAX_RUNS];
+    int nsizes = 0;
+    int any_engine = 0;
+    int any_distribution = 0;
+    int first = 1;
+    int matched;
+    int status;
+    int i;
+    int j;
+    int k;
+    FILE *out = stdout;
+    pid_t pid;
+
+    for (j = 0; j < MAX_RUNS; j++)
+    {
+        use_engine[j] = 0;
+        use_distribution[j] = 0;
+    }
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc && nsizes < MAX_RUNS)
+        {
+            sizes[nsizes] = atol(argv[++i]);
+            if (sizes[nsizes++] <= 0)
+            {
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+        {
+            i++;
+            matched = 0;
+            for (j = 0; j < NENGINES; j++)
+            {
+                if (strcmp(argv[i], engines[j].name) == 0)
+                {
+                    use_engine[j] = any_engine = matched = 1;
+                }
+            }
+            if (!matched)
+            {
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+        {
+            i++;
+            matched = 0;
+            for (j = 0; j < NDISTRIBUTIONS; j++)
+            {
+                if (strcmp(argv[i], distributions[j].name) == 0)
+                {
+                    use_distribution[j] = any_distribution = matched = 1;
+                }
+            }
+            if (!matched)
+            {
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            random_state = strtoul(argv[++i], NULL, 10) & 0xffffffffUL;
+            if (random_state == 0)
+            {
+                random_state = 1;
+            }
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            out = fopen(argv[++i], "w");
+            if (out == NULL)
+            {
+                fprintf(stderr, "Output file \"%s\" could not be opened! "
+                                "Terminating program.\n", argv[i]);
+                return 1;
+            }
+        }
+        else
+        {
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    /* By default run everything at 1K, 10K and 100K tokens. */
+    if (nsizes == 0)
+    {
+        sizes[nsizes++] = 1000;
+        sizes[nsizes++] = 10000;
+        sizes[nsizes++] = 100000;
+    }
+
+    fprintf(out, "[\n");
+    for (i = 0; i < nsizes; i++)
+    {
+        for (k = 0; k < NDISTRIBUTIONS; k++)
+        {
+            if (any_distribution && !use_distribution[k])
+            {
+                continue;
+            }
+            for (j = 0; j < NENGINES; j++)
+            {
+                if (any_engine && !use_engine[j])
+                {
+                    continue;
+                }
+
+                fprintf(stderr, "%s/%s %s %ld\n", engines[j].name,
+                        engines[j].hash, distributions[k].name, sizes[i]);
+                fprintf(out, "%s", first ? "" : ",\n");
+                first = 0;
+                fflush(out);
+
+                /* The child inherits the random state, so every engine
+                 * sees the same corpus. */
+                pid = fork();
+                if (pid == 0)
+                {
+                    status = run_one(out, &engines[j], &distributions[k],
+                                     sizes[i]);
+                    fflush(out);
+                    _exit(status);
+                }
+                if (pid < 0 || waitpid(pid, &status, 0) != pid
+                    || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                {
+                    fprintf(stderr, "Benchmark run failed!\n");
+                    return 1;
+                }
+            }
+        }
+    }
+    fprintf(out, "\n]\n");
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
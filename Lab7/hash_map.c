@@ -0,0 +1,29 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: hash_map.c
+ *     Helper functions shared by all the maps generated by hash_map.h.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "hash_map.h"
+
+
+/*
+ * The MurmurHash3 finalizer, masked to 32 bits so the result is the same
+ * whatever the size of 'unsigned long'.
+ */
+unsigned long hash_map_mix(unsigned long h)
+{
+    HASH_MAP_MIX(h);
+    return h;
+}
+
+
+void hash_map_out_of_memory(void)
+{
+    fprintf(stderr, "Error! Memory allocation failed!\n");
+    exit(1);
+}
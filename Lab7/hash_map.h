@@ -0,0 +1,453 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: hash_map.h
+ *     Macros that generate open-addressing hash maps specialized for a
+ *     given key and value type.
+ *
+ *     HASH_MAP_DECLARE(name, K, V) declares a map type 'name' from keys
+ *     of type K to values of type V and its functions, and goes in a
+ *     header.  HASH_MAP_DEFINE(name, K, V, HASH, EQUAL) defines the
+ *     functions and goes in exactly one source file.  HASH(k) must give
+ *     an unsigned 32-bit hash of a key and EQUAL(a, b) must be nonzero
+ *     for equal keys; both are expanded in place, so a map is as fast as
+ *     the same code written out by hand.
+ *
+ *     STRING_MAP_DECLARE(name, V) and STRING_MAP_DEFINE(name, V) do the
+ *     same for zero-terminated string keys.  Keys shorter than
+ *     STRING_MAP_INLINE bytes are copied into the slot itself, so looking
+ *     them up never follows a pointer; longer keys are copied to the heap.
+ *     STRING_MAP_DEFINE_HASH(name, V, HASH) uses another string hash
+ *     than the default STRING_MAP_FNV_HASH; HASH(key, len, h) must be a
+ *     statement that sets 'len' to the length of 'key' and 'h' to its
+ *     32-bit hash.
+ *
+ *     The generated functions for a map 'name' are:
+ *
+ *         name *name_create(void);
+ *         void  name_free(name *m);
+ *         V    *name_find(name *m, K key);    NULL if not found
+ *         V    *name_insert(name *m, K key);  added with value 0
+ *         size_t name_next(name *m, size_t i);
+ *
+ *     'name_insert' returns the value of an existing key, so counting is
+ *     just "(*name_insert(m, key))++".  The returned pointer is valid
+ *     until the next insertion.  'name_next' returns the first used slot
+ *     at or after slot 'i', or m->nslots if there is none, for visiting
+ *     every entry.
+ *
+ *     No semicolon is needed after any of the macros.
+ *
+ */
+
+#ifndef HASH_MAP_H
+#define HASH_MAP_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Number of slots in a new map (a power of two). */
+#define HASH_MAP_INITIAL_SLOTS 16
+
+/* Slot states. */
+#define HASH_MAP_EMPTY  0
+#define HASH_MAP_USED   1   /* used; for string maps, key is inline */
+#define HASH_MAP_HEAP   2   /* used, string key is on the heap */
+
+/* String keys shorter than this are stored inside the slot. */
+#define STRING_MAP_INLINE 16
+
+/* The key of a used string map slot. */
+#define STRING_MAP_KEY(s) \
+    ((s)->state == HASH_MAP_HEAP ? (s)->key.heap_key : (s)->key.inline_key)
+
+/* Mix the bits of 'h' in place (the MurmurHash3 finalizer). */
+#define HASH_MAP_MIX(h)                                                   \
+    do                                                                    \
+    {                                                                     \
+        (h) &= 0xffffffffUL;                                              \
+        (h) ^= (h) >> 16;                                                 \
+        (h) = ((h) * 0x85ebca6bUL) & 0xffffffffUL;                        \
+        (h) ^= (h) >> 13;                                                 \
+        (h) = ((h) * 0xc2b2ae35UL) & 0xffffffffUL;                        \
+        (h) ^= (h) >> 16;                                                 \
+    } while (0)
+
+/* FNV-1a followed by HASH_MAP_MIX: the default string hash. */
+#define STRING_MAP_FNV_HASH(key, len, h)                                  \
+    do                                                                    \
+    {                                                                     \
+        const char *p_ = (key);                                           \
+                                                                          \
+        (h) = 2166136261UL;                                               \
+        while (*p_)                                                       \
+        {                                                                 \
+            (h) ^= (unsigned char) *p_++;                                 \
+            (h) = ((h) * 16777619UL) & 0xffffffffUL;                      \
+        }                                                                 \
+        (len) = (size_t) (p_ - (key));                                    \
+        HASH_MAP_MIX(h);                                                  \
+    } while (0)
+
+/* A good hash for integer keys. */
+#define HASH_MAP_INT_HASH(k)    hash_map_mix((unsigned long) (k))
+
+/* Equality for keys that can be compared with '=='. */
+#define HASH_MAP_EQUAL(a, b)    ((a) == (b))
+
+/* HASH_MAP_MIX as a function, for use in expressions. */
+unsigned long hash_map_mix(unsigned long h);
+
+/* Print an error message and exit; called when allocation fails. */
+void hash_map_out_of_memory(void);
+
+
+/*
+ * Maps from any key type that can be assigned and compared.
+ */
+
+#define HASH_MAP_DECLARE(name, K, V)                                      \
+typedef struct                                                            \
+{                                                                         \
+    K key;                                                                \
+    V value;                                                              \
+    unsigned long hash;                                                   \
+    unsigned char state;                                                  \
+} name##_slot;                                                            \
+                                                                          \
+typedef struct                                                            \
+{                                                                         \
+    name##_slot *slot;                                                    \
+    size_t nslots;      /* a power of two */                              \
+    size_t size;        /* number of keys */                              \
+} name;                                                                   \
+                                                                          \
+name *name##_create(void);                                                \
+void name##_free(name *m);                                                \
+V *name##_find(name *m, K key);                                           \
+V *name##_insert(name *m, K key);                                         \
+size_t name##_next(name *m, size_t i);
+
+
+#define HASH_MAP_DEFINE(name, K, V, HASH, EQUAL)                          \
+name *name##_create(void)                                                 \
+{                                                                         \
+    name *m;                                                              \
+                                                                          \
+    m = (name *) malloc(sizeof(name));                                    \
+    if (m == NULL)                                                        \
+    {                                                                     \
+        hash_map_out_of_memory();                                         \
+    }                                                                     \
+    m->nslots = HASH_MAP_INITIAL_SLOTS;                                   \
+    m->size = 0;                                                          \
+    m->slot = (name##_slot *) calloc(m->nslots, sizeof(name##_slot));     \
+    if (m->slot == NULL)                                                  \
+    {                                                                     \
+        hash_map_out_of_memory();                                         \
+    }                                                                     \
+    return m;                                                             \
+}                                                                         \
+                                                                          \
+void name##_free(name *m)                                                 \
+{                                                                         \
+    free(m->slot);                                                        \
+    free(m);                                                              \
+}                                                                         \
+                                                                          \
+/* Return the slot holding 'key', or the empty slot where it belongs. */  \
+static name##_slot *name##_probe(name *m, K key, unsigned long h)         \
+{                                                                         \
+    name##_slot *s;                                                       \
+    size_t mask = m->nslots - 1;                                          \
+    size_t i = h & mask;                                                  \
+                                                                          \
+    for (;;)                                                              \
+    {                                                                     \
+        s = &m->slot[i];                                                  \
+        if (s->state == HASH_MAP_EMPTY                                    \
+            || (s->hash == h && EQUAL(s->key, key)))                      \
+        {                                                                 \
+            return s;                                                     \
+        }                                                                 \
+        i = (i + 1) & mask;                                               \
+    }                                                                     \
+}                                                                         \
+                                                                          \
+/* Double the number of slots, reusing the stored hashes. */              \
+static void name##_grow(name *m)                                          \
+{                                                                         \
+    name##_slot *old = m->slot;                                           \
+    size_t nold = m->nslots;                                              \
+    size_t mask;                                                          \
+    size_t i;                                                             \
+    size_t j;                                                             \
+                                                                          \
+    m->nslots *= 2;                                                       \
+    m->slot = (name##_slot *) calloc(m->nslots, sizeof(name##_slot));     \
+    if (m->slot == NULL)                                                  \
+    {                                                                     \
+        hash_map_out_of_memory();                                         \
+    }                                                                     \
+    mask = m->nslots - 1;                                                 \
+    for (i = 0; i < nold; i++)                                            \
+    {                                                                     \
+        if (old[i].state != HASH_MAP_EMPTY)                               \
+        {                                                                 \
+            for (j = old[i].hash & mask;                                  \
+                 m->slot[j].state != HASH_MAP_EMPTY;                      \
+                 j = (j + 1) & mask)                                      \
+            {                                                             \
+                ;                                                         \
+            }                                                             \
+            m->slot[j] = old[i];                                          \
+        }                                                                 \
+    }                                                                     \
+    free(old);                                                            \
+}                                                                         \
+                                                                          \
+V *name##_find(name *m, K key)                                            \
+{                                                                         \
+    name##_slot *s = name##_probe(m, key, HASH(key));                     \
+                                                                          \
+    return (s->state == HASH_MAP_EMPTY) ? NULL : &s->value;               \
+}                                                                         \
+                                                                          \
+V *name##_insert(name *m, K key)                                          \
+{                                                                         \
+    name##_slot *s;                                                       \
+    unsigned long h = HASH(key);                                          \
+                                                                          \
+    /* Keep the map at most three quarters full. */                       \
+    if (4 * (m->size + 1) > 3 * m->nslots)                                \
+    {                                                                     \
+        name##_grow(m);                                                   \
+    }                                                                     \
+    s = name##_probe(m, key, h);                                          \
+    if (s->state == HASH_MAP_EMPTY)                                       \
+    {                                                                     \
+        s->key = key;                                                     \
+        s->hash = h;                                                      \
+        s->state = HASH_MAP_USED;                                         \
+        memset(&s->value, 0, sizeof(V));                                  \
+        m->size++;                                                        \
+    }                                                                     \
+    return &s->value;                                                     \
+}                                                                         \
+                                                                          \
+size_t name##_next(name *m, size_t i)                                     \
+{                                                                         \
+    while (i < m->nslots && m->slot[i].state == HASH_MAP_EMPTY)           \
+    {                                                                     \
+        i++;                                                              \
+    }                                                                     \
+    return i;                                                             \
+}
+
+
+/*
+ * Maps from zero-terminated strings, with short keys stored inline.
+ * The map owns copies of its keys; the caller's strings are not kept.
+ */
+
+#define STRING_MAP_DECLARE(name, V)                                       \
+typedef struct                                                            \
+{                                                                         \
+    unsigned int hash;                                                    \
+    unsigned char state;                                                  \
+    unsigned char len;  /* length of an inline key */                     \
+    V value;                                                              \
+    union                                                                 \
+    {                                                                     \
+        char inline_key[STRING_MAP_INLINE];                               \
+        char *heap_key;                                                   \
+    } key;                                                                \
+} name##_slot;                                                            \
+                                                                          \
+typedef struct                                                            \
+{                                                                         \
+    name##_slot *slot;                                                    \
+    size_t nslots;      /* a power of two */                              \
+    size_t size;        /* number of keys */                              \
+} name;                                                                   \
+                                                                          \
+name *name##_create(void);                                                \
+void name##_free(name *m);                                                \
+V *name##_find(name *m, const char *key);                                 \
+V *name##_insert(name *m, const char *key);                               \
+size_t name##_next(name *m, size_t i);
+
+
+#define STRING_MAP_DEFINE(name, V)                                        \
+    STRING_MAP_DEFINE_HASH(name, V, STRING_MAP_FNV_HASH)
+
+
+#define STRING_MAP_DEFINE_HASH(name, V, HASH)                             \
+name *name##_create(void)                                                 \
+{                                                                         \
+    name *m;                                                              \
+                                                                          \
+    m = (name *) malloc(sizeof(name));                                    \
+    if (m == NULL)                                                        \
+    {                                                                     \
+        hash_map_out_of_memory();                                         \
+    }                                                                     \
+    m->nslots = HASH_MAP_INITIAL_SLOTS;                                   \
+    m->size = 0;                                                          \
+    m->slot = (name##_slot *) calloc(m->nslots, sizeof(name##_slot));     \
+    if (m->slot == NULL)                                                  \
+    {                                                                     \
+        hash_map_out_of_memory();                                         \
+    }                                                                     \
+    return m;                                                             \
+}                                                                         \
+                                                                          \
+void name##_free(name *m)                                                 \
+{                                                                         \
+    size_t i;                                                             \
+                                                                          \
+    for (i = 0; i < m->nslots; i++)                                       \
+    {                                                                     \
+        if (m->slot[i].state == HASH_MAP_HEAP)                            \
+        {                                                                 \
+            free(m->slot[i].key.heap_key);                                \
+        }                                                                 \
+    }                                                                     \
+    free(m->slot);                                                        \
+    free(m);                                                              \
+}                                                                         \
+                                                                          \
+/* Hash the key and find its length in the same pass. */                 \
+static unsigned int name##_hash(const char *key, size_t *len)             \
+{                                                                         \
+    unsigned long h;                                                      \
+    size_t n;                                                             \
+                                                                          \
+    HASH(key, n, h);                                                      \
+    *len = n;                                                             \
+    return (unsigned int) h;                                              \
+}                                                                         \
+                                                                          \
+/* Return the slot holding 'key', or the empty slot where it belongs. */  \
+static name##_slot *name##_probe(name *m, const char *key,                \
+                                 unsigned int h, size_t len)              \
+{                                                                         \
+    name##_slot *s;                                                       \
+    size_t mask = m->nslots - 1;                                          \
+    size_t i = h & mask;                                                  \
+                                                                          \
+    for (;;)                                                              \
+    {                                                                     \
+        s = &m->slot[i];                                                  \
+        if (s->state == HASH_MAP_EMPTY)                                   \
+        {                                                                 \
+            return s;                                                     \
+        }                                                                 \
+        if (s->hash == h)                                                 \
+        {                                                                 \
+            if (s->state == HASH_MAP_USED)                                \
+            {                                                             \
+                if (s->len == len                                         \
+                    && memcmp(s->key.inline_key, key, len) == 0)          \
+                {                                                         \
+                    return s;                                             \
+                }                                                         \
+            }                                                             \
+            else if (strcmp(s->key.heap_key, key) == 0)                   \
+            {                                                             \
+                return s;                                                 \
+            }                                                             \
+        }                                                                 \
+        i = (i + 1) & mask;                                               \
+    }                                                                     \
+}                                                                         \
+                                                                          \
+/* Double the number of slots, reusing the stored hashes. */              \
+static void name##_grow(name *m)                                          \
+{                                                                         \
+    name##_slot *old = m->slot;                                           \
+    size_t nold = m->nslots;                                              \
+    size_t mask;                                                          \
+    size_t i;                                                             \
+    size_t j;                                                             \
+                                                                          \
+    m->nslots *= 2;                                                       \
+    m->slot = (name##_slot *) calloc(m->nslots, sizeof(name##_slot));     \
+    if (m->slot == NULL)                                                  \
+    {                                                                     \
+        hash_map_out_of_memory();                                         \
+    }                                                                     \
+    mask = m->nslots - 1;                                                 \
+    for (i = 0; i < nold; i++)                                            \
+    {                                                                     \
+        if (old[i].state != HASH_MAP_EMPTY)                               \
+        {                                                                 \
+            for (j = old[i].hash & mask;                                  \
+                 m->slot[j].state != HASH_MAP_EMPTY;                      \
+                 j = (j + 1) & mask)                                      \
+            {                                                             \
+                ;                                                         \
+            }                                                             \
+            m->slot[j] = old[i];                                          \
+        }                                                                 \
+    }                                                                     \
+    free(old);                                                            \
+}                                                                         \
+                                                                          \
+V *name##_find(name *m, const char *key)                                  \
+{                                                                         \
+    size_t len;                                                           \
+    unsigned int h = name##_hash(key, &len);                              \
+    name##_slot *s = name##_probe(m, key, h, len);                        \
+                                                                          \
+    return (s->state == HASH_MAP_EMPTY) ? NULL : &s->value;               \
+}                                                                         \
+                                                                          \
+V *name##_insert(name *m, const char *key)                                \
+{                                                                         \
+    name##_slot *s;                                                       \
+    size_t len;                                                           \
+    unsigned int h = name##_hash(key, &len);                              \
+                                                                          \
+    /* Keep the map at most three quarters full. */                       \
+    if (4 * (m->size + 1) > 3 * m->nslots)                                \
+    {                                                                     \
+        name##_grow(m);                                                   \
+    }                                                                     \
+    s = name##_probe(m, key, h, len);                                     \
+    if (s->state == HASH_MAP_EMPTY)                                       \
+    {                                                                     \
+        if (len < STRING_MAP_INLINE)                                      \
+        {                                                                 \
+            memcpy(s->key.inline_key, key, len + 1);                      \
+            s->len = (unsigned char) len;                                 \
+            s->state = HASH_MAP_USED;                                     \
+        }                                                                 \
+        else                                                              \
+        {                                                                 \
+            s->key.heap_key = (char *) malloc(len + 1);                   \
+            if (s->key.heap_key == NULL)                                  \
+            {                                                             \
+                hash_map_out_of_memory();                                 \
+            }                                                             \
+            memcpy(s->key.heap_key, key, len + 1);                        \
+            s->state = HASH_MAP_HEAP;                                     \
+        }                                                                 \
+        s->hash = h;                                                      \
+        memset(&s->value, 0, sizeof(V));                                  \
+        m->size++;                                                        \
+    }                                                                     \
+    return &s->value;                                                     \
+}                                                                         \
+                                                                          \
+size_t name##_next(name *m, size_t i)                                     \
+{                                                                         \
+    while (i < m->nslots && m->slot[i].state == HASH_MAP_EMPTY)           \
+    {                                                                     \
+        i++;                                                              \
+    }                                                                     \
+    return i;                                                             \
+}
+
+#endif  /* HASH_MAP_H */
@@ -101,14 +101,20 @@ hash_table *create_hash_table()
         exit(1);
     }
 
-    /* Creating the node pointer array in the hash table structure. */
-    ht->slot = (node **) malloc(sizeof(node)*NSLOTS);
+    /*
+     * Creating the node pointer array in the hash table structure.  Every
+     * slot starts out as an empty list, so the array has to be zeroed.
+     */
+    ht->slot = (node **) calloc(NSLOTS, sizeof(node *));
     /* Checking memorry allocation did not fail. */
     if (ht->slot == NULL)
     {
         fprintf(stderr, "Error! Memory allocation failed!\n");
         exit(1);
     }
+
+    ht->changes = NULL;
+    ht->counters = NULL;
     
     return ht;
 }
@@ -128,6 +134,16 @@ void free_hash_table(hash_table *ht)
         free_list(ht->slot[i]);
     }
     free(ht->slot);
+    if (ht->changes != NULL)
+    {
+        free(ht->changes->changed);
+        free(ht->changes->index);
+        free(ht->changes);
+    }
+    if (ht->counters != NULL)
+    {
+        free(ht->counters);
+    }
     free(ht);
 }
 
@@ -139,20 +155,121 @@ void free_hash_table(hash_table *ht)
 int get_value(hash_table *ht, char *key)
 {
     int index;
+    long probes;
     node *curr;
 
     index = hash(key);
     curr = ht->slot[index];
 
+    probes = 0;
     while (curr !=NULL)
     {
+        probes++;
         if (strcmp(curr->key, key) == 0)
         {
-            return curr->value;
+            break;
         }
         curr = curr->next;
     }
-    return 0;
+
+    if (ht->counters != NULL)
+    {
+        ht->counters->lookups++;
+        ht->counters->probes += probes;
+    }
+    return (curr != NULL) ? curr->value : 0;
+}
+
+
+/*** Change tracking. ***/
+
+/* Slot of the change log index where node 'n' is or would go. */
+static int find_change(change_log *log, node *n)
+{
+    unsigned long h;
+    int i;
+
+    h = (unsigned long) n / sizeof(node);
+    i = (int) ((h * 2654435761UL) & log->index_mask);
+    while (log->index[i] != -1 && log->changed[log->index[i]].key_node != n)
+    {
+        i = (i + 1) & log->index_mask;
+    }
+    return i;
+}
+
+
+/* Allocate an index of 'size' empty slots for a change log. */
+static void make_change_index(change_log *log, int size)
+{
+    int i;
+
+    log->index = (int *) malloc(size * sizeof(int));
+    /* Checking memorry allocation did not fail. */
+    if (log->index == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+    for (i = 0; i < size; i++)
+    {
+        log->index[i] = -1;
+    }
+    log->index_mask = size - 1;
+}
+
+
+/*
+ * Record that node 'n', whose value was 'old_value', has been changed,
+ * if changes are tracked and it was not already changed since the last
+ * 'print_changes'.
+ */
+static void mark_changed(hash_table *ht, node *n, int old_value)
+{
+    change_log *log;
+    int *old_index;
+    int i;
+    int slot;
+
+    log = ht->changes;
+    if (log == NULL)
+    {
+        return;
+    }
+    slot = find_change(log, n);
+    if (log->index[slot] != -1)
+    {
+        return;
+    }
+
+    if (log->count == log->capacity)
+    {
+        log->capacity *= 2;
+        log->changed = (changed_key *) realloc(log->changed,
+                           log->capacity * sizeof(changed_key));
+        /* Checking memorry allocation did not fail. */
+        if (log->changed == NULL)
+        {
+            fprintf(stderr, "Error! Memory allocation failed!\n");
+            exit(1);
+        }
+    }
+    log->changed[log->count].key_node = n;
+    log->changed[log->count].last_value = old_value;
+    log->index[slot] = log->count;
+    log->count++;
+
+    /* Keep the index at most half full so that probes stay short. */
+    if (2 * log->count > log->index_mask + 1)
+    {
+        old_index = log->index;
+        make_change_index(log, 2 * (log->index_mask + 1));
+        free(old_index);
+        for (i = 0; i < log->count; i++)
+        {
+            log->index[find_change(log, log->changed[i].key_node)] = i;
+        }
+    }
 }
 
 
@@ -164,6 +281,7 @@ int get_value(hash_table *ht, char *key)
 void set_value(hash_table *ht, char *key, int value)
 {
     int index;
+    long probes;
     node *curr;
     node *start;
     node *new;
@@ -177,24 +295,43 @@ void set_value(hash_table *ht, char *key, int value)
 
     
     curr = start;
+    probes = 0;
     while (curr != NULL)
     {
+        probes++;
         /* If key exists, change the value to `value` and return. */
         if (strcmp(curr->key, key) == 0)
         {
+            mark_changed(ht, curr, curr->value);
             curr->value = value;
             free(key);
+            if (ht->counters != NULL)
+            {
+                ht->counters->lookups++;
+                ht->counters->probes += probes;
+                ht->counters->updates++;
+            }
             return;
         }
         curr = curr->next;
     }
 
+    if (ht->counters != NULL)
+    {
+        ht->counters->lookups++;
+        ht->counters->probes += probes;
+        ht->counters->inserts++;
+        ht->counters->alloc_count += 2;
+        ht->counters->alloc_bytes += sizeof(node) + strlen(key) + 1;
+    }
+
     /* 
      * Create a new node at the beginning of the linked list if key did
      *  not exist. 
      */
     new = create_node(key, value);
     new->next = start;
+    mark_changed(ht, new, 0);
 
     ht->slot[index] = new;
 }
@@ -220,3 +357,388 @@ void print_hash_table(hash_table *ht)
 }
 
 
+/*** Statistics. ***/
+
+/* Fill in 'stats' by walking every chain of the hash table. */
+void get_hash_table_stats(hash_table *ht, hash_table_stats *stats)
+{
+    node *curr;
+    int nonempty;
+    int len;
+    int i;
+
+    memset(stats, 0, sizeof(hash_table_stats));
+    stats->nslots = NSLOTS;
+    stats->node_bytes = NSLOTS * sizeof(node *);
+
+    nonempty = 0;
+    for (i = 0; i < NSLOTS; i++)
+    {
+        len = 0;
+        for (curr = ht->slot[i]; curr != NULL; curr = curr->next)
+        {
+            len++;
+            stats->key_bytes += strlen(curr->key) + 1;
+        }
+
+        stats->chain_hist[len < STATS_HIST_SIZE - 1
+                          ? len : STATS_HIST_SIZE - 1]++;
+        if (len > stats->max_chain)
+        {
+            stats->max_chain = len;
+        }
+        if (len > 0)
+        {
+            nonempty++;
+        }
+        stats->entries += len;
+    }
+
+    stats->node_bytes += stats->entries * sizeof(node);
+    stats->load_factor = (double) stats->entries / NSLOTS;
+    stats->mean_chain = nonempty ? (double) stats->entries / nonempty : 0.0;
+}
+
+
+/* Start keeping running counters. */
+void enable_hash_table_counters(hash_table *ht)
+{
+    if (ht->counters == NULL)
+    {
+        ht->counters = (hash_table_counters *)
+            calloc(1, sizeof(hash_table_counters));
+        /* Checking memorry allocation did not fail. */
+        if (ht->counters == NULL)
+        {
+            fprintf(stderr, "Error! Memory allocation failed!\n");
+            exit(1);
+        }
+    }
+}
+
+
+/* Print the stats of the table, and its counters if kept, to stderr. */
+void print_hash_table_stats(hash_table *ht)
+{
+    hash_table_stats stats;
+    hash_table_counters *c;
+    int i;
+
+    get_hash_table_stats(ht, &stats);
+
+    fprintf(stderr, "entries: %ld, slots: %d, load factor: %.2f\n",
+            stats.entries, stats.nslots, stats.load_factor);
+    fprintf(stderr, "chain length: max %d, mean %.2f\n",
+            stats.max_chain, stats.mean_chain);
+    fprintf(stderr, "chain histogram:");
+    for (i = 0; i < STATS_HIST_SIZE; i++)
+    {
+        fprintf(stderr, " %d%s:%ld", i, i == STATS_HIST_SIZE - 1 ? "+" : "",
+                stats.chain_hist[i]);
+    }
+    fprintf(stderr, "\nmemory: %ld bytes of nodes, %ld bytes of keys\n",
+            stats.node_bytes, stats.key_bytes);
+
+    c = ht->counters;
+    if (c != NULL)
+    {
+        fprintf(stderr, "lookups: %ld, probes: %ld (%.2f per lookup), "
+                        "inserts: %ld, updates: %ld\n",
+                c->lookups, c->probes,
+                c->lookups ? (double) c->probes / c->lookups : 0.0,
+                c->inserts, c->updates);
+        fprintf(stderr, "allocations: %ld, %ld bytes\n",
+                c->alloc_count, c->alloc_bytes);
+    }
+}
+
+
+/* Start recording which keys change. */
+void track_changes(hash_table *ht)
+{
+    change_log *log;
+
+    if (ht->changes != NULL)
+    {
+        return;
+    }
+    log = (change_log *) malloc(sizeof(change_log));
+    /* Checking memorry allocation did not fail. */
+    if (log == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+    log->count = 0;
+    log->capacity = 64;
+    log->changed = (changed_key *) malloc(log->capacity
+                                          * sizeof(changed_key));
+    /* Checking memorry allocation did not fail. */
+    if (log->changed == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+    make_change_index(log, 2 * log->capacity);
+    ht->changes = log;
+}
+
+
+/*
+ * Print and forget the keys changed since the last call.  Only the
+ * changed keys are visited, and clearing their index slots empties the
+ * whole index.  The slots are cleared newest first: the probes for a
+ * node only pass over nodes recorded before it, which are still there.
+ */
+void print_changes(hash_table *ht)
+{
+    change_log *log;
+    changed_key *c;
+    int i;
+
+    log = ht->changes;
+    if (log == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < log->count; i++)
+    {
+        c = &log->changed[i];
+        if (c->key_node->value != c->last_value)
+        {
+            printf("%s %d %+d\n", c->key_node->key, c->key_node->value,
+                   c->key_node->value - c->last_value);
+        }
+    }
+    for (i = log->count - 1; i >= 0; i--)
+    {
+        log->index[find_change(log, log->changed[i].key_node)] = -1;
+    }
+    log->count = 0;
+}
+
+
+/*** Sorted and top-K output. ***/
+
+/*
+ * Compare two nodes by rank: a node with a larger value ranks higher,
+ * and between equal values the smaller key ranks higher.  Returns a
+ * positive number if 'a' ranks higher than 'b', negative if lower.
+ */
+static int compare_rank(node *a, node *b)
+{
+    if (a->value != b->value)
+    {
+        return (a->value > b->value) ? 1 : -1;
+    }
+    return strcmp(b->key, a->key);
+}
+
+
+/* Comparison function for `qsort`: increasing order of key. */
+static int compare_keys(const void *a, const void *b)
+{
+    return strcmp((*(node * const *) a)->key, (*(node * const *) b)->key);
+}
+
+
+/* Comparison function for `qsort`: decreasing order of rank. */
+static int compare_counts(const void *a, const void *b)
+{
+    return compare_rank(*(node * const *) b, *(node * const *) a);
+}
+
+
+/* Return the number of key/value pairs stored in the hash table. */
+int count_entries(hash_table *ht)
+{
+    node *curr;
+    int i;
+    int count;
+
+    count = 0;
+    for (i = 0; i < NSLOTS; i++)
+    {
+        for (curr = ht->slot[i]; curr != NULL; curr = curr->next)
+        {
+            count++;
+        }
+    }
+    return count;
+}
+
+
+/*
+ * Collect pointers to all the nodes of the hash table into a newly
+ * allocated array, sort it with `cmp` and print it.
+ */
+static void print_sorted(hash_table *ht,
+                         int (*cmp)(const void *, const void *))
+{
+    node **entries;
+    node *curr;
+    int count;
+    int i;
+    int n;
+
+    count = count_entries(ht);
+    if (count == 0)
+    {
+        return;
+    }
+
+    entries = (node **) malloc(count * sizeof(node *));
+    /* Checking memorry allocation did not fail. */
+    if (entries == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+
+    n = 0;
+    for (i = 0; i < NSLOTS; i++)
+    {
+        for (curr = ht->slot[i]; curr != NULL; curr = curr->next)
+        {
+            entries[n++] = curr;
+        }
+    }
+
+    qsort(entries, count, sizeof(node *), cmp);
+
+    for (i = 0; i < count; i++)
+    {
+        printf("%s %d\n", entries[i]->key, entries[i]->value);
+    }
+
+    free(entries);
+}
+
+
+/* Print the key/value pairs in increasing order of key. */
+void print_sorted_by_key(hash_table *ht)
+{
+    print_sorted(ht, compare_keys);
+}
+
+
+/* Print the key/value pairs in decreasing order of value. */
+void print_sorted_by_count(hash_table *ht)
+{
+    print_sorted(ht, compare_counts);
+}
+
+
+/*
+ * Restore the min-heap property of 'heap' (ordered by rank, lowest rank
+ * at the root) starting from position 'i' and moving down.
+ */
+static void sift_down(node **heap, int size, int i)
+{
+    int child;
+    node *temp;
+
+    while ((child = 2 * i + 1) < size)
+    {
+        /* Pick the lower-ranked of the two children. */
+        if (child + 1 < size && compare_rank(heap[child + 1], heap[child]) < 0)
+        {
+            child++;
+        }
+        if (compare_rank(heap[child], heap[i]) >= 0)
+        {
+            break;
+        }
+        temp = heap[i];
+        heap[i] = heap[child];
+        heap[child] = temp;
+        i = child;
+    }
+}
+
+
+/*
+ * Find the 'k' nodes with the largest values.  The table is scanned once
+ * while a min-heap of the best 'k' nodes seen so far is kept in 'out', so
+ * the work is O(n log k) and nothing else is allocated.
+ */
+int top_k_entries(hash_table *ht, int k, node **out)
+{
+    node *curr;
+    node *temp;
+    int size;
+    int i;
+
+    size = 0;
+    for (i = 0; i < NSLOTS && k > 0; i++)
+    {
+        for (curr = ht->slot[i]; curr != NULL; curr = curr->next)
+        {
+            if (size < k)
+            {
+                /* Heap not full yet: add the node and sift it up. */
+                int j = size++;
+
+                out[j] = curr;
+                while (j > 0 && compare_rank(out[j], out[(j - 1) / 2]) < 0)
+                {
+                    temp = out[j];
+                    out[j] = out[(j - 1) / 2];
+                    out[(j - 1) / 2] = temp;
+                    j = (j - 1) / 2;
+                }
+            }
+            else if (compare_rank(curr, out[0]) > 0)
+            {
+                /* Replace the lowest-ranked node kept so far. */
+                out[0] = curr;
+                sift_down(out, size, 0);
+            }
+        }
+    }
+
+    /*
+     * Pop the heap from the back: each pop moves the lowest remaining
+     * node to the end, which leaves the array in decreasing rank order.
+     */
+    for (i = size - 1; i > 0; i--)
+    {
+        temp = out[0];
+        out[0] = out[i];
+        out[i] = temp;
+        sift_down(out, i, 0);
+    }
+
+    return size;
+}
+
+
+/* Print the 'k' pairs with the largest values. */
+void print_top_k(hash_table *ht, int k)
+{
+    node **heap;
+    int size;
+    int i;
+
+    if (k <= 0)
+    {
+        return;
+    }
+
+    heap = (node **) malloc(k * sizeof(node *));
+    /* Checking memorry allocation did not fail. */
+    if (heap == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+
+    size = top_k_entries(ht, k, heap);
+
+    for (i = 0; i < size; i++)
+    {
+        printf("%s %d\n", heap[i]->key, heap[i]->value);
+    }
+
+    free(heap);
+}
@@ -17,6 +17,9 @@
 /* Number of slots in the hash table array. */
 #define NSLOTS 128
 
+/* Chain lengths 0 .. STATS_HIST_SIZE - 2, and STATS_HIST_SIZE - 1 or more. */
+#define STATS_HIST_SIZE 16
+
 /*
  * Data structure definitions.
  */
@@ -32,16 +35,75 @@ typedef struct _node
     struct _node *next; /* pointer to the next node in the list */
 } node;
 
+/*
+ * The keys whose value changed since the last 'print_changes', kept
+ * apart from the nodes so that tables which do not track changes pay
+ * nothing for it.  'changed' holds each such node once, in the order of
+ * its first change, with its value before that change.  'index' maps
+ * node addresses to positions in 'changed' (-1 for an empty slot).
+ */
+
+typedef struct
+{
+    node *key_node;
+    int last_value;     /* value at the last 'print_changes' */
+} changed_key;
+
+typedef struct
+{
+    changed_key *changed;
+    int count;
+    int capacity;
+    int *index;
+    int index_mask;     /* index size - 1 (a power of two) */
+} change_log;
+
+/*
+ * Running counts of the work done by a hash table.  Only kept once
+ * 'enable_hash_table_counters' has been called.
+ */
+
+typedef struct
+{
+    long lookups;       /* calls to 'get_value' and 'set_value' */
+    long probes;        /* nodes compared against a key */
+    long inserts;       /* keys added */
+    long updates;       /* values changed for existing keys */
+    long alloc_count;   /* nodes and keys taken over by the table */
+    long alloc_bytes;   /* bytes in those nodes and keys */
+} hash_table_counters;
+
 /*
  * Declaration of the hash table struct.
  * 'slot' is an array of node pointers, so it's a pointer to a pointer.
+ * 'changes' is NULL unless changes are tracked, and 'counters' is NULL
+ * unless counting is enabled.
  */
 
 typedef struct
 {
     node **slot;
+    change_log *changes;
+    hash_table_counters *counters;
 } hash_table;
 
+/*
+ * A summary of how the keys of a hash table are spread over its slots,
+ * computed by 'get_hash_table_stats'.
+ */
+
+typedef struct
+{
+    long entries;
+    int nslots;
+    double load_factor;     /* entries per slot */
+    int max_chain;
+    double mean_chain;      /* mean length of the nonempty chains */
+    long chain_hist[STATS_HIST_SIZE];   /* number of slots by chain length */
+    long node_bytes;        /* memory used by nodes and the slot array */
+    long key_bytes;         /* memory used by keys */
+} hash_table_stats;
+
 
 /*
  * Function declarations.
@@ -83,6 +145,61 @@ void set_value(hash_table *ht, char *key, int value);
 /* Print out the contents of the hash table as key/value pairs. */
 void print_hash_table(hash_table *ht);
 
+/* Fill in 'stats' by walking every chain of the hash table. */
+void get_hash_table_stats(hash_table *ht, hash_table_stats *stats);
+
+/*
+ * Start keeping running counters.  Each lookup or update then costs a
+ * few extra additions.  While counters are off, the probes of a lookup
+ * are still counted in a local variable, and storing them costs only a
+ * NULL test.
+ */
+void enable_hash_table_counters(hash_table *ht);
+
+/* Print the stats of the table, and its counters if kept, to stderr. */
+void print_hash_table_stats(hash_table *ht);
+
+/*
+ * Start recording which keys have their value changed by 'set_value'.
+ * Each update then costs a lookup by node address in the change log,
+ * and lets 'print_changes' visit just the changed keys instead of the
+ * whole table.  Tables that do not track changes only test a pointer.
+ */
+void track_changes(hash_table *ht);
+
+/*
+ * Print the key, value and change in value of every key whose value
+ * changed since the last call (or since 'track_changes' was called), then
+ * start recording changes afresh.
+ */
+void print_changes(hash_table *ht);
+
+/* Return the number of key/value pairs stored in the hash table. */
+int count_entries(hash_table *ht);
+
+/* Print the key/value pairs in increasing order of key. */
+void print_sorted_by_key(hash_table *ht);
+
+/*
+ * Print the key/value pairs in decreasing order of value.  Pairs with
+ * equal values are printed in increasing order of key.
+ */
+void print_sorted_by_count(hash_table *ht);
+
+/*
+ * Store pointers to the (at most) 'k' nodes with the largest values into
+ * 'out', in the same order as 'print_sorted_by_count', and return how
+ * many were stored.  'out' must have room for 'k' pointers.
+ */
+int top_k_entries(hash_table *ht, int k, node **out);
+
+/*
+ * Print the 'k' pairs with the largest values, in the same order as
+ * 'print_sorted_by_count'.  Only 'k' entries are ever held at once, so
+ * this does not need to copy or sort the whole table.
+ */
+void print_top_k(hash_table *ht, int k);
+
 /* This line is part of the "include guard": */
 #endif  /* HASH_TABLE_H */
 
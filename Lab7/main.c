@@ -6,97 +6,813 @@
  *
  */
 
+/* Needed for select, read, open and clock_gettime under -ansi. */
+#define _POSIX_C_SOURCE 200112L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/select.h>
 #include "hash_table.h"
+#include "sketch.h"
+#include "table_file.h"
+#include "word_map.h"
 #include "memcheck.h"
 
 #define MAX_WORD_LENGTH 100
 
 
+/* Output modes for the word counts. */
+#define OUTPUT_TABLE    0   /* Table order (default). */
+#define OUTPUT_KEY      1   /* Sorted by key.         */
+#define OUTPUT_COUNT    2   /* Sorted by count.       */
+#define OUTPUT_TOP_K    3   /* Only the top K counts. */
+
+/*
+ * Number of words printed in approximate mode and in snapshots when `-k`
+ * is not given.
+ */
+#define DEFAULT_TOP_K   10
+
+/* Bytes of input read at a time. */
+#define READ_BUFFER_SIZE 65536
+
+
+/*
+ * Lines read from a file descriptor.  The bytes not yet returned are
+ * buffer[start] to buffer[end - 1].
+ */
+typedef struct
+{
+    int  fd;
+    int  start;
+    int  end;
+    int  at_end;        /* set once the input is exhausted */
+    char buffer[READ_BUFFER_SIZE];
+} line_reader;
+
+
 void usage(char *progname)
 {
-    fprintf(stderr, "usage: %s filename\n", progname);
+    fprintf(stderr, "usage: %s [-s key|count] [-k N] [-a KB [-v]] "
+                    "[-l table] [-o table] [-S]\n"
+                    "           [-n words] [-t seconds] [-d] [-H] "
+                    "filename|-\n"
+                    "       %s -m [-s key] filename|-\n"
+                    "       %s -l table -g word\n",
+            progname, progname, progname);
 }
 
-void add_to_hash_table(hash_table *ht, char *key)
+/* Add 1 to the count of 'key' and return the new count. */
+int add_to_hash_table(hash_table *ht, char *key)
 {
     int v = get_value(ht, key);
     set_value(ht, key, v + 1);
+    return v + 1;
+}
+
+
+/* Current time in seconds, from a clock that is never set back. */
+double now_seconds(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/*
+ * Read the next line from 'r' into 'line' the way `fgets` would: at
+ * most 'size' - 1 characters, up to and including a newline.  If
+ * 'timeout' is not negative, give up when no whole line has arrived
+ * within 'timeout' seconds; the part already read is kept for the next
+ * call.  Return 1 if a line was read, 0 at the end of the input, and -1
+ * on a timeout.
+ */
+int read_line(line_reader *r, char *line, int size, double timeout)
+{
+    char *newline;
+    int n;
+    fd_set ready;
+    struct timeval tv;
+
+    for (;;)
+    {
+        /* Return a whole line, a full buffer, or the last bytes. */
+        n = r->end - r->start;
+        newline = (char *) memchr(r->buffer + r->start, '\n', n);
+        if (newline != NULL)
+        {
+            n = newline - (r->buffer + r->start) + 1;
+        }
+        if (n > size - 1)
+        {
+            n = size - 1;
+        }
+        if (newline != NULL || n == size - 1 || (r->at_end && n > 0))
+        {
+            memcpy(line, r->buffer + r->start, n);
+            line[n] = '\0';
+            r->start += n;
+            return 1;
+        }
+        if (r->at_end)
+        {
+            return 0;
+        }
+
+        /* Move the partial line to the front and read some more. */
+        memmove(r->buffer, r->buffer + r->start, n);
+        r->start = 0;
+        r->end = n;
+
+        if (timeout >= 0)
+        {
+            FD_ZERO(&ready);
+            FD_SET(r->fd, &ready);
+            tv.tv_sec = (long) timeout;
+            tv.tv_usec = (long) ((timeout - tv.tv_sec) * 1e6);
+            if (select(r->fd + 1, &ready, NULL, NULL, &tv) <= 0)
+            {
+                return -1;
+            }
+        }
+        n = read(r->fd, r->buffer + r->end, READ_BUFFER_SIZE - r->end);
+        if (n > 0)
+        {
+            r->end += n;
+        }
+        else if (n == 0 || errno != EINTR)
+        {
+            r->at_end = 1;
+        }
+    }
+}
+
+
+/*
+ * Make a heap of the 'k' words of 'ht' with the largest counts, to be
+ * kept up to date with `heavy_hitters_update` as words are counted.  As
+ * counts only grow, and ties are broken by key as in `print_top_k`, it
+ * then always holds the exact top K.
+ */
+heavy_hitters *create_top_k(hash_table *ht, int k)
+{
+    heavy_hitters *top;
+    node *curr;
+    int i;
+
+    top = create_heavy_hitters(k);
+    for (i = 0; i < NSLOTS; i++)
+    {
+        for (curr = ht->slot[i]; curr != NULL; curr = curr->next)
+        {
+            heavy_hitters_update(top, curr->key,
+                                 (unsigned long) curr->value);
+        }
+    }
+    return top;
+}
+
+
+/*
+ * Count one word in each of the counters in use: the hash table 'ht',
+ * with the heap of its top K words 'top', the approximate counter 'ws'
+ * and the word map 'wm'.  Any of them may be NULL.
+ */
+void count_word(char *word, hash_table *ht, word_sketch *ws, word_map *wm,
+                heavy_hitters *top)
+{
+    char *new_word;
+    int count;
+
+    /*
+     * The approximate counter and the word map do not need their own
+     * copy of the word.
+     */
+    if (ws != NULL)
+    {
+        word_sketch_add(ws, word);
+    }
+    if (wm != NULL)
+    {
+        (*word_map_insert(wm, word))++;
+    }
+
+    if (ht != NULL)
+    {
+        /* Copy the word.  Add 1 for the zero byte at the end. */
+        new_word = (char *)calloc(strlen(word) + 1, sizeof(char));
+
+        if (new_word == NULL)
+        {
+            fprintf(stderr, "Error: memory allocation failed! "
+                            "Terminating program.\n");
+            exit(1);
+        }
+
+        strcpy(new_word, word);
+
+        /*
+         * Add it to the hash table, which takes 'new_word', and keep the
+         * top K words up to date.
+         */
+        count = add_to_hash_table(ht, new_word);
+        if (top != NULL)
+        {
+            heavy_hitters_update(top, word, (unsigned long) count);
+        }
+    }
+}
+
+
+/*
+ * Print a snapshot of the counts so far: the changes since the previous
+ * snapshot if 'delta' is set, otherwise the current top K words, from
+ * the sketch in approximate mode and from the heap 'top' otherwise.
+ * Delta snapshots visit only the changed keys and top K snapshots only
+ * the K words kept, so no snapshot takes time that grows with the size
+ * of the table.
+ */
+void print_snapshot(hash_table *ht, word_sketch *ws, heavy_hitters *top,
+                    int delta, int number, unsigned long total_words)
+{
+    printf("# snapshot %d after %lu words\n", number, total_words);
+    if (delta)
+    {
+        print_changes(ht);
+    }
+    else if (ws != NULL)
+    {
+        print_word_sketch(ws);
+    }
+    else
+    {
+        print_heavy_hitters(top);
+    }
+
+    /* Make the snapshot visible at once even when writing to a pipe. */
+    fflush(stdout);
+}
+
+
+/*
+ * Print the live heap to stderr, and the call sites whose live memory
+ * changed since the heap snapshot 'previous' if there is one.  Return a
+ * new heap snapshot to compare the next one with.
+ */
+memcheck_snapshot *print_heap_snapshot(memcheck_snapshot *previous)
+{
+    memcheck_snapshot *current;
+
+    current = take_memcheck_snapshot();
+    print_memcheck_stats();
+    if (previous != NULL)
+    {
+        print_memcheck_snapshot_diff(previous, current);
+        free_memcheck_snapshot(previous);
+    }
+    return current;
+}
+
+
+/*
+ * Compare the approximate counts in 'ws' with the exact counts in 'ht'
+ * and print the error of each part of the sketch to stderr.
+ */
+void report_accuracy(word_sketch *ws, hash_table *ht, int k)
+{
+    node **exact_top;
+    heavy_hitter **approx_top;
+    node *curr;
+    int n_exact;
+    int n_approx;
+    int found;
+    int i;
+    int j;
+    long distinct;
+    long n_keys_exact;
+    unsigned long err;
+    unsigned long max_err;
+    double total_err;
+    double distinct_est;
+
+    /* Count-Min Sketch: the overestimate of every word's count. */
+    distinct = 0;
+    n_keys_exact = 0;
+    max_err = 0;
+    total_err = 0.0;
+    for (i = 0; i < NSLOTS; i++)
+    {
+        for (curr = ht->slot[i]; curr != NULL; curr = curr->next)
+        {
+            err = cms_estimate(ws->cms, curr->key)
+                - (unsigned long) curr->value;
+            total_err += err;
+            if (err > max_err)
+            {
+                max_err = err;
+            }
+            if (err == 0)
+            {
+                n_keys_exact++;
+            }
+            distinct++;
+        }
+    }
+
+    /* Heavy hitters: how many of the exact top K words were found. */
+    exact_top = (node **) malloc(k * sizeof(node *));
+    approx_top = (heavy_hitter **) malloc(k * sizeof(heavy_hitter *));
+    if (exact_top == NULL || approx_top == NULL)
+    {
+        fprintf(stderr, "Error: memory allocation failed! "
+                        "Terminating program.\n");
+        exit(1);
+    }
+    n_exact = top_k_entries(ht, k, exact_top);
+    n_approx = heavy_hitters_sorted(ws->top, approx_top);
+
+    found = 0;
+    for (i = 0; i < n_exact; i++)
+    {
+        for (j = 0; j < n_approx; j++)
+        {
+            if (strcmp(exact_top[i]->key, approx_top[j]->key) == 0)
+            {
+                found++;
+                break;
+            }
+        }
+    }
+
+    distinct_est = hll_estimate(ws->hll);
+
+    fprintf(stderr, "count-min sketch: %d x %d counters, "
+                    "mean error %.3f, max error %lu, %.1f%% exact\n",
+            ws->cms->depth, ws->cms->width,
+            distinct > 0 ? total_err / distinct : 0.0, max_err,
+            distinct > 0 ? 100.0 * n_keys_exact / distinct : 100.0);
+    fprintf(stderr, "heavy hitters: %d of the top %d words found\n",
+            found, n_exact);
+    fprintf(stderr, "hyperloglog: %.0f distinct words estimated, "
+                    "%ld exact (%.2f%% error)\n",
+            distinct_est, distinct,
+            distinct > 0 ? 100.0 * (distinct_est - distinct) / distinct
+                         : 0.0);
+
+    free(exact_top);
+    free(approx_top);
 }
 
 
 int main(int argc, char **argv)
 {
     int   nwords;
-    FILE *input_file;
+    int   status;
+    line_reader *input;
     char  word[MAX_WORD_LENGTH];
     char  line[MAX_WORD_LENGTH];
-    char *new_word;
+    char *filename;
+    int   output_mode;
+    int   top_k;
+    int   i;
+    int   approximate;
+    int   verify;
+    long  sketch_kb;
+    char *load_name;
+    char *save_name;
+    char *query;
+    int   delta;
+    int   use_map;
+    int   show_stats;
+    int   heap_stats;
+    int   snapshots;          /* set if snapshots are asked for */
+    int   snapshot_count;     /* snapshots printed so far */
+    long  snapshot_words;
+    long  snapshot_seconds;
+    int   snapshot_due;
+    unsigned long total_words;
+    double next_snapshot;
+    double timeout;
     hash_table *ht;
+    heavy_hitters *top;
+    mapped_table *mt;
+    word_sketch *ws;
+    word_map *wm;
+    memcheck_snapshot *heap_snap;
+
+    /*
+     * Parse the command line.  `-s key` and `-s count` print the table
+     *     sorted by key or by decreasing count, `-k N` prints only the N
+     *     most frequent words.  `-a KB` counts approximately in a fixed
+     *     KB kilobytes of memory, and `-v` then also counts exactly and
+     *     reports the accuracy of the approximation.  `-l table` adds the
+     *     counts saved in a table file, `-o table` saves the final counts,
+     *     and `-g word` only looks the word up in the `-l` table file.
+     *     A filename of `-` reads words from standard input as they
+     *     arrive; `-n N` and `-t T` print a snapshot of the top K words
+     *     every N words or T seconds, and `-d` makes the snapshots list
+     *     only the changes since the previous one.  `-m` counts with the
+     *     generic word map instead of the hash table.  `-S` keeps
+     *     counters in the hash table and prints its statistics to stderr.
+     *     `-H` adds the live heap, and the call sites whose memory grew
+     *     since the previous snapshot, to each snapshot (on stderr).
+     */
+    filename = NULL;
+    output_mode = OUTPUT_TABLE;
+    top_k = 0;
+    approximate = 0;
+    verify = 0;
+    sketch_kb = 0;
+    load_name = NULL;
+    save_name = NULL;
+    query = NULL;
+    delta = 0;
+    use_map = 0;
+    show_stats = 0;
+    heap_stats = 0;
+    snapshot_words = 0;
+    snapshot_seconds = 0;
+    snapshot_count = 0;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+        {
+            i++;
+            if (strcmp(argv[i], "key") == 0)
+            {
+                output_mode = OUTPUT_KEY;
+            }
+            else if (strcmp(argv[i], "count") == 0)
+            {
+                output_mode = OUTPUT_COUNT;
+            }
+            else
+            {
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-k") == 0 && i + 1 < argc)
+        {
+            output_mode = OUTPUT_TOP_K;
+            top_k = atoi(argv[++i]);
+            if (top_k <= 0)
+            {
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+        {
+            approximate = 1;
+            sketch_kb = atol(argv[++i]);
+            if (sketch_kb <= 0 || sketch_kb > SKETCH_MAX_KB)
+            {
+                fprintf(stderr, "The sketch takes 1 to %ld KB.\n",
+                        (long) SKETCH_MAX_KB);
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-v") == 0)
+        {
+            verify = 1;
+        }
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc)
+        {
+            load_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            save_name = argv[++i];
+        }
+        else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+        {
+            query = argv[++i];
+        }
+        else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            snapshot_words = atol(argv[++i]);
+            if (snapshot_words <= 0)
+            {
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+            snapshot_seconds = atol(argv[++i]);
+            if (snapshot_seconds <= 0)
+            {
+                usage(argv[0]);
+                exit(1);
+            }
+        }
+        else if (strcmp(argv[i], "-d") == 0)
+        {
+            delta = 1;
+        }
+        else if (strcmp(argv[i], "-m") == 0)
+        {
+            use_map = 1;
+        }
+        else if (strcmp(argv[i], "-S") == 0)
+        {
+            show_stats = 1;
+        }
+        else if (strcmp(argv[i], "-H") == 0)
+        {
+            heap_stats = 1;
+        }
+        else if (filename == NULL
+                 && (argv[i][0] != '-' || strcmp(argv[i], "-") == 0))
+        {
+            filename = argv[i];
+        }
+        else
+        {
+            usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    /*
+     * Look a word up in a saved table without building anything.  The
+     * file is used in place, so this takes the same time however large
+     * the table is.
+     */
+    if (query != NULL)
+    {
+        if (load_name == NULL || filename != NULL)
+        {
+            usage(argv[0]);
+            exit(1);
+        }
 
-    if (argc != 2)
+        mt = open_mapped_table(load_name);
+        if (mt == NULL)
+        {
+            fprintf(stderr, "Table file \"%s\" could not be read! "
+                            "Terminating program.\n", load_name);
+            return 1;
+        }
+        printf("%s %d\n", query, mapped_get_value(mt, query));
+        close_mapped_table(mt);
+        print_memory_leaks();
+        return 0;
+    }
+
+    /*
+     * Only the top K words can be printed in approximate mode, table
+     * files hold exact counts only, and delta snapshots need exact counts.
+     */
+    snapshots = (snapshot_words > 0 || snapshot_seconds > 0);
+    if (filename == NULL || (verify && !approximate)
+        || (approximate && output_mode != OUTPUT_TABLE
+            && output_mode != OUTPUT_TOP_K)
+        || (approximate && (load_name != NULL || save_name != NULL))
+        || (delta && (!snapshots || approximate))
+        || (heap_stats && !snapshots)
+        || (show_stats && (use_map || (approximate && !verify)))
+        || (use_map && (approximate || load_name != NULL
+                        || save_name != NULL || snapshots
+                        || (output_mode != OUTPUT_TABLE
+                            && output_mode != OUTPUT_KEY))))
     {
         usage(argv[0]);
         exit(1);
     }
 
-    /* Make the hash table. */
-    ht = create_hash_table();
+    if (top_k == 0)
+    {
+        top_k = DEFAULT_TOP_K;
+    }
+
+    /*
+     * Make the hash table, unless only approximate counts are wanted or
+     * the word map is used instead, and the fixed-size approximate
+     * counter if it is.
+     */
+    ht = NULL;
+    ws = NULL;
+    wm = NULL;
+    if (use_map)
+    {
+        wm = word_map_create();
+    }
+    else if (!approximate || verify)
+    {
+        ht = create_hash_table();
+        if (show_stats)
+        {
+            enable_hash_table_counters(ht);
+        }
+    }
+    if (approximate)
+    {
+        ws = create_word_sketch(sketch_kb * 1024, top_k);
+    }
+
+    /* Start from the counts of a previously saved table. */
+    if (load_name != NULL)
+    {
+        mt = open_mapped_table(load_name);
+        if (mt == NULL)
+        {
+            fprintf(stderr, "Table file \"%s\" could not be read! "
+                            "Terminating program.\n", load_name);
+            return 1;
+        }
+        merge_mapped_table(ht, mt);
+        close_mapped_table(mt);
+    }
+
+    /*
+     * Delta snapshots only visit the keys changed since the last one,
+     * and exact top K snapshots only the heap of the top K words.
+     */
+    top = NULL;
+    if (delta)
+    {
+        track_changes(ht);
+    }
+    else if (snapshots && ws == NULL)
+    {
+        top = create_top_k(ht, top_k);
+    }
 
     /*
      * Open the input file.  For simplicity, we specify that the
      * input file has to contain exactly one word per line.
      */
-    input_file = fopen(argv[1], "r");
+    input = (line_reader *) malloc(sizeof(line_reader));
+    if (input == NULL)
+    {
+        fprintf(stderr, "Error: memory allocation failed! "
+                        "Terminating program.\n");
+        return 1;
+    }
+    input->start = 0;
+    input->end = 0;
+    input->at_end = 0;
+    if (strcmp(filename, "-") == 0)
+    {
+        input->fd = STDIN_FILENO;
+    }
+    else
+    {
+        input->fd = open(filename, O_RDONLY);
+    }
 
-    if (input_file == NULL)  /* Open failed. */
+    if (input->fd < 0)  /* Open failed. */
     {
         fprintf(stderr, "Input file \"%s\" does not exist! "
-                        "Terminating program.\n", argv[1]);
+                        "Terminating program.\n", filename);
         return 1;
     }
 
-    /* Add the words to the hash table until there are none left. */
+    /*
+     * Add the words to the hash table until there are none left.  When
+     * reading a stream, snapshots are printed between words, so counting
+     * carries on straight after each one.  With `-t` the wait for input
+     * ends when the next snapshot is due, so snapshots keep coming while
+     * the stream is idle.
+     */
+
+    total_words = 0;
+    next_snapshot = now_seconds() + snapshot_seconds;
+    heap_snap = heap_stats ? take_memcheck_snapshot() : NULL;
 
-    while (fgets(line, MAX_WORD_LENGTH, input_file) != NULL)
+    for (;;)
     {
+        timeout = -1.0;
+        if (snapshot_seconds > 0)
+        {
+            timeout = next_snapshot - now_seconds();
+            if (timeout < 0)
+            {
+                timeout = 0;
+            }
+        }
+        status = read_line(input, line, MAX_WORD_LENGTH, timeout);
+        if (status == 0)
+        {
+            break;
+        }
+
+        snapshot_due = (snapshot_seconds > 0
+                        && now_seconds() >= next_snapshot);
+
         /* Clear the contents of 'word'. */
         word[0] = '\0';
 
-        /* Convert the line to a word. */
-        nwords = sscanf(line, "%s", word);
-
-        if (nwords != 1)  /* Conversion failed, e.g. due to a blank line. */
+        /*
+         * Convert the line to a word, and count it.  There is none on a
+         * timeout, or if the conversion failed, e.g. due to a blank line.
+         */
+        nwords = (status == 1) ? sscanf(line, "%s", word) : 0;
+        if (nwords == 1)
         {
-            continue;
+            count_word(word, ht, ws, wm, top);
+            total_words++;
         }
-        else
-        {
-            /* Copy the word.  Add 1 for the zero byte at the end. */
-            new_word = (char *)calloc(strlen(word) + 1, sizeof(char));
 
-            if (new_word == NULL)
+        if (snapshot_due
+            || (nwords == 1 && snapshot_words > 0
+                && total_words % snapshot_words == 0))
+        {
+            print_snapshot(ht, ws, top, delta, ++snapshot_count,
+                           total_words);
+            if (heap_stats)
             {
-                fprintf(stderr, "Error: memory allocation failed! "
-                                "Terminating program.\n");
-                return 1;
+                heap_snap = print_heap_snapshot(heap_snap);
             }
+            next_snapshot = now_seconds() + snapshot_seconds;
+        }
+    }
 
-            strcpy(new_word, word);
-
-            /* Add it to the hash table. */
-            add_to_hash_table(ht, new_word);
+    /*
+     * Print out the hash table key/value pairs, or the approximate top
+     * words followed by a summary of the approximate counter.
+     */
+    if (use_map)
+    {
+        print_word_map(wm, output_mode == OUTPUT_KEY);
+    }
+    else if (approximate)
+    {
+        print_word_sketch(ws);
+        fprintf(stderr, "%lu words, about %.0f distinct, "
+                        "%ld bytes of counters\n",
+                ws->total, hll_estimate(ws->hll), word_sketch_memory(ws));
+        if (verify)
+        {
+            report_accuracy(ws, ht, top_k);
+        }
+    }
+    else
+    {
+        switch (output_mode)
+        {
+        case OUTPUT_KEY:
+            print_sorted_by_key(ht);
+            break;
+        case OUTPUT_COUNT:
+            print_sorted_by_count(ht);
+            break;
+        case OUTPUT_TOP_K:
+            print_top_k(ht, top_k);
+            break;
+        default:
+            print_hash_table(ht);
+            break;
         }
     }
 
-    /* Print out the hash table key/value pairs. */
-    print_hash_table(ht);
+    if (show_stats)
+    {
+        print_hash_table_stats(ht);
+    }
+
+    /* Save the counts for later runs. */
+    if (save_name != NULL && save_hash_table(ht, save_name) != 0)
+    {
+        fprintf(stderr, "Table file \"%s\" could not be written! "
+                        "Terminating program.\n", save_name);
+        return 1;
+    }
 
     /* Clean up. */
-    free_hash_table(ht);
-    fclose(input_file);
+    if (ht != NULL)
+    {
+        free_hash_table(ht);
+    }
+    if (ws != NULL)
+    {
+        free_word_sketch(ws);
+    }
+    if (wm != NULL)
+    {
+        word_map_free(wm);
+    }
+    if (top != NULL)
+    {
+        free_heavy_hitters(top);
+    }
+    if (input->fd != STDIN_FILENO)
+    {
+        close(input->fd);
+    }
+    free(input);
+    free_memcheck_snapshot(heap_snap);
 
     /* Check for memory leaks. */
     print_memory_leaks();
@@ -0,0 +1,585 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: sketch.c
+ *     Implementation of the fixed-memory approximate word counter.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "sketch.h"
+#include "memcheck.h"
+
+#define MASK32 0xffffffffUL
+
+
+/* Allocate memory or terminate the program if allocation fails. */
+static void *sketch_alloc(size_t nmemb, size_t size)
+{
+    void *mem;
+
+    mem = calloc(nmemb, size);
+    /* Checking memorry allocation did not fail. */
+    if (mem == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+    return mem;
+}
+
+
+/*** Hash function. ***/
+
+/*
+ * FNV-1a over the characters of the string followed by the MurmurHash3
+ * finalizer, so that every output bit depends on every input bit.  All
+ * arithmetic is masked to 32 bits so the result is the same whatever the
+ * size of 'unsigned long'.
+ */
+unsigned long sketch_hash(char *s, unsigned long seed)
+{
+    unsigned long h;
+
+    h = (2166136261UL ^ (seed * 0x9e3779b9UL)) & MASK32;
+    while (*s)
+    {
+        h ^= (unsigned char) *s++;
+        h = (h * 16777619UL) & MASK32;
+    }
+
+    h ^= h >> 16;
+    h = (h * 0x85ebca6bUL) & MASK32;
+    h ^= h >> 13;
+    h = (h * 0xc2b2ae35UL) & MASK32;
+    h ^= h >> 16;
+
+    return h;
+}
+
+
+/*** Count-Min Sketch. ***/
+
+count_min_sketch *create_count_min_sketch(int width, int depth)
+{
+    count_min_sketch *cms;
+    int w;
+
+    /* Round the width down to a power of two so rows can be masked. */
+    for (w = 1; w * 2 <= width; w *= 2)
+    {
+        ;
+    }
+
+    cms = (count_min_sketch *) sketch_alloc(1, sizeof(count_min_sketch));
+    cms->width = w;
+    cms->depth = depth;
+    cms->count = (unsigned long *) sketch_alloc((size_t) w * depth,
+                                                sizeof(unsigned long));
+    return cms;
+}
+
+
+void free_count_min_sketch(count_min_sketch *cms)
+{
+    free(cms->count);
+    free(cms);
+}
+
+
+/*
+ * Row 'i' uses the hash h1 + i * h2 (double hashing), so two string
+ * hashes are enough for any number of rows.
+ */
+static unsigned long *cms_counter(count_min_sketch *cms, int row,
+                                  unsigned long h1, unsigned long h2)
+{
+    unsigned long col;
+
+    col = (h1 + (unsigned long) row * h2) & (unsigned long) (cms->width - 1);
+    return &cms->count[(size_t) row * cms->width + col];
+}
+
+
+static unsigned long cms_estimate_hashed(count_min_sketch *cms,
+                                         unsigned long h1, unsigned long h2)
+{
+    unsigned long min;
+    unsigned long c;
+    int i;
+
+    min = *cms_counter(cms, 0, h1, h2);
+    for (i = 1; i < cms->depth; i++)
+    {
+        c = *cms_counter(cms, i, h1, h2);
+        if (c < min)
+        {
+            min = c;
+        }
+    }
+    return min;
+}
+
+
+static unsigned long cms_add_hashed(count_min_sketch *cms,
+                                    unsigned long h1, unsigned long h2)
+{
+    unsigned long min;
+    unsigned long *c;
+    int i;
+
+    /* Conservative update: only raise the counters holding the minimum. */
+    min = cms_estimate_hashed(cms, h1, h2);
+    for (i = 0; i < cms->depth; i++)
+    {
+        c = cms_counter(cms, i, h1, h2);
+        if (*c == min)
+        {
+            *c = min + 1;
+        }
+    }
+    return min + 1;
+}
+
+
+unsigned long cms_add(count_min_sketch *cms, char *key)
+{
+    return cms_add_hashed(cms, sketch_hash(key, 0),
+                          sketch_hash(key, 1) | 1);
+}
+
+
+unsigned long cms_estimate(count_min_sketch *cms, char *key)
+{
+    return cms_estimate_hashed(cms, sketch_hash(key, 0),
+                               sketch_hash(key, 1) | 1);
+}
+
+
+/*** Heavy hitters. ***/
+
+heavy_hitters *create_heavy_hitters(int capacity)
+{
+    heavy_hitters *hh;
+    int nindex;
+    int i;
+
+    /* Keep the index at most half full. */
+    for (nindex = 2; nindex < 2 * capacity; nindex *= 2)
+    {
+        ;
+    }
+
+    hh = (heavy_hitters *) sketch_alloc(1, sizeof(heavy_hitters));
+    hh->capacity = capacity;
+    hh->size = 0;
+    hh->entry = (heavy_hitter *) sketch_alloc(capacity,
+                                              sizeof(heavy_hitter));
+    hh->heap = (int *) sketch_alloc(capacity, sizeof(int));
+    hh->index = (int *) sketch_alloc(nindex, sizeof(int));
+    hh->index_mask = nindex - 1;
+
+    for (i = 0; i < nindex; i++)
+    {
+        hh->index[i] = -1;
+    }
+    return hh;
+}
+
+
+void free_heavy_hitters(heavy_hitters *hh)
+{
+    free(hh->entry);
+    free(hh->heap);
+    free(hh->index);
+    free(hh);
+}
+
+
+/*
+ * Return a positive number if entry 'a' ranks below entry 'b' in the
+ * heap: a smaller count, or an equal count and a larger key.
+ */
+static int ranks_below(heavy_hitters *hh, int a, int b)
+{
+    heavy_hitter *x = &hh->entry[a];
+    heavy_hitter *y = &hh->entry[b];
+
+    if (x->count != y->count)
+    {
+        return x->count < y->count;
+    }
+    return strcmp(x->key, y->key) > 0;
+}
+
+
+/* Swap two heap positions and keep the entries' back-pointers right. */
+static void heap_swap(heavy_hitters *hh, int i, int j)
+{
+    int temp;
+
+    temp = hh->heap[i];
+    hh->heap[i] = hh->heap[j];
+    hh->heap[j] = temp;
+    hh->entry[hh->heap[i]].heap_pos = i;
+    hh->entry[hh->heap[j]].heap_pos = j;
+}
+
+
+static void heap_sift_up(heavy_hitters *hh, int i)
+{
+    while (i > 0 && ranks_below(hh, hh->heap[i], hh->heap[(i - 1) / 2]))
+    {
+        heap_swap(hh, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+
+static void heap_sift_down(heavy_hitters *hh, int i)
+{
+    int child;
+
+    while ((child = 2 * i + 1) < hh->size)
+    {
+        if (child + 1 < hh->size
+            && ranks_below(hh, hh->heap[child + 1], hh->heap[child]))
+        {
+            child++;
+        }
+        if (!ranks_below(hh, hh->heap[child], hh->heap[i]))
+        {
+            break;
+        }
+        heap_swap(hh, i, child);
+        i = child;
+    }
+}
+
+
+/* Return the index position holding 'key', or of the empty slot ending
+ * its probe sequence if it is not tracked. */
+static int index_find(heavy_hitters *hh, char *key, unsigned long hash)
+{
+    int pos;
+    int e;
+
+    pos = (int) (hash & (unsigned long) hh->index_mask);
+    while ((e = hh->index[pos]) != -1)
+    {
+        if (hh->entry[e].hash == hash && strcmp(hh->entry[e].key, key) == 0)
+        {
+            break;
+        }
+        pos = (pos + 1) & hh->index_mask;
+    }
+    return pos;
+}
+
+
+/*
+ * Remove the index slot 'pos' and shift the following entries of the
+ * probe run back, so the table never needs tombstones.
+ */
+static void index_remove(heavy_hitters *hh, int pos)
+{
+    int next;
+    int home;
+    int mask = hh->index_mask;
+
+    next = pos;
+    for (;;)
+    {
+        next = (next + 1) & mask;
+        if (hh->index[next] == -1)
+        {
+            break;
+        }
+        home = (int) (hh->entry[hh->index[next]].hash
+                      & (unsigned long) mask);
+
+        /* Move the entry back unless its home lies in (pos, next]. */
+        if (((next - home) & mask) >= ((next - pos) & mask))
+        {
+            hh->index[pos] = hh->index[next];
+            pos = next;
+        }
+    }
+    hh->index[pos] = -1;
+}
+
+
+static void heavy_hitters_update_hashed(heavy_hitters *hh, char *key,
+                                        unsigned long hash,
+                                        unsigned long count)
+{
+    heavy_hitter *e;
+    int pos;
+    int id;
+
+    pos = index_find(hh, key, hash);
+
+    if (hh->index[pos] != -1)
+    {
+        /* Already tracked: its count only grows, so it sinks. */
+        e = &hh->entry[hh->index[pos]];
+        e->count = count;
+        heap_sift_down(hh, e->heap_pos);
+        return;
+    }
+
+    if (hh->size < hh->capacity)
+    {
+        id = hh->size++;
+        hh->heap[id] = id;
+        hh->entry[id].heap_pos = id;
+    }
+    else
+    {
+        /* Only replace the smallest entry if the new count beats it. */
+        id = hh->heap[0];
+        e = &hh->entry[id];
+        if (count < e->count
+            || (count == e->count && strcmp(key, e->key) > 0))
+        {
+            return;
+        }
+        index_remove(hh, index_find(hh, e->key, e->hash));
+        pos = index_find(hh, key, hash);
+    }
+
+    e = &hh->entry[id];
+    strncpy(e->key, key, SKETCH_MAX_KEY - 1);
+    e->key[SKETCH_MAX_KEY - 1] = '\0';
+    e->hash = hash;
+    e->count = count;
+    hh->index[pos] = id;
+
+    heap_sift_up(hh, e->heap_pos);
+    heap_sift_down(hh, e->heap_pos);
+}
+
+
+void heavy_hitters_update(heavy_hitters *hh, char *key, unsigned long count)
+{
+    heavy_hitters_update_hashed(hh, key, sketch_hash(key, 0), count);
+}
+
+
+/* Comparison function for `qsort`: decreasing count, then increasing key. */
+static int compare_hitters(const void *a, const void *b)
+{
+    heavy_hitter *x = *(heavy_hitter * const *) a;
+    heavy_hitter *y = *(heavy_hitter * const *) b;
+
+    if (x->count != y->count)
+    {
+        return (x->count < y->count) ? 1 : -1;
+    }
+    return strcmp(x->key, y->key);
+}
+
+
+int heavy_hitters_sorted(heavy_hitters *hh, heavy_hitter **out)
+{
+    int i;
+
+    for (i = 0; i < hh->size; i++)
+    {
+        out[i] = &hh->entry[i];
+    }
+    qsort(out, hh->size, sizeof(heavy_hitter *), compare_hitters);
+    return hh->size;
+}
+
+
+void print_heavy_hitters(heavy_hitters *hh)
+{
+    heavy_hitter **top;
+    int n;
+    int i;
+
+    top = (heavy_hitter **) sketch_alloc(hh->capacity,
+                                         sizeof(heavy_hitter *));
+    n = heavy_hitters_sorted(hh, top);
+    for (i = 0; i < n; i++)
+    {
+        printf("%s %lu\n", top[i]->key, top[i]->count);
+    }
+    free(top);
+}
+
+
+/*** HyperLogLog. ***/
+
+hyper_log_log *create_hyper_log_log(int precision)
+{
+    hyper_log_log *hll;
+
+    if (precision < 4)
+    {
+        precision = 4;
+    }
+    else if (precision > 16)
+    {
+        precision = 16;
+    }
+
+    hll = (hyper_log_log *) sketch_alloc(1, sizeof(hyper_log_log));
+    hll->precision = precision;
+    hll->nregisters = 1 << precision;
+    hll->reg = (unsigned char *) sketch_alloc(hll->nregisters, 1);
+    return hll;
+}
+
+
+void free_hyper_log_log(hyper_log_log *hll)
+{
+    free(hll->reg);
+    free(hll);
+}
+
+
+/*
+ * The top 'precision' bits of the hash select a register, which keeps the
+ * largest position of the first 1 bit seen in the remaining bits.
+ */
+static void hll_add_hashed(hyper_log_log *hll, unsigned long hash)
+{
+    int idx;
+    int rank;
+    int nbits;
+    unsigned long rest;
+
+    nbits = 32 - hll->precision;
+    idx = (int) (hash >> nbits);
+    rest = hash & ((1UL << nbits) - 1);
+
+    rank = 1;
+    while (rank <= nbits && !(rest & (1UL << (nbits - rank))))
+    {
+        rank++;
+    }
+
+    if (rank > hll->reg[idx])
+    {
+        hll->reg[idx] = (unsigned char) rank;
+    }
+}
+
+
+void hll_add(hyper_log_log *hll, char *key)
+{
+    hll_add_hashed(hll, sketch_hash(key, 0));
+}
+
+
+double hll_estimate(hyper_log_log *hll)
+{
+    double m = hll->nregisters;
+    double sum;
+    double estimate;
+    double two32 = 4294967296.0;
+    int zeros;
+    int i;
+
+    sum = 0.0;
+    zeros = 0;
+    for (i = 0; i < hll->nregisters; i++)
+    {
+        sum += ldexp(1.0, -hll->reg[i]);
+        if (hll->reg[i] == 0)
+        {
+            zeros++;
+        }
+    }
+
+    estimate = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+
+    /* Small and large range corrections from the original paper. */
+    if (estimate <= 2.5 * m && zeros > 0)
+    {
+        estimate = m * log(m / zeros);
+    }
+    else if (estimate > two32 / 30.0)
+    {
+        estimate = -two32 * log(1.0 - estimate / two32);
+    }
+    return estimate;
+}
+
+
+/*** Approximate word counter. ***/
+
+word_sketch *create_word_sketch(long cms_bytes, int k)
+{
+    word_sketch *ws;
+    long width;
+
+    width = cms_bytes / (SKETCH_DEPTH * (long) sizeof(unsigned long));
+    if (width < 16)
+    {
+        width = 16;
+    }
+    else if (width > SKETCH_MAX_WIDTH)
+    {
+        width = SKETCH_MAX_WIDTH;
+    }
+
+    ws = (word_sketch *) sketch_alloc(1, sizeof(word_sketch));
+    ws->cms = create_count_min_sketch((int) width, SKETCH_DEPTH);
+    ws->top = create_heavy_hitters(k);
+    ws->hll = create_hyper_log_log(SKETCH_PRECISION);
+    ws->total = 0;
+    return ws;
+}
+
+
+void free_word_sketch(word_sketch *ws)
+{
+    free_count_min_sketch(ws->cms);
+    free_heavy_hitters(ws->top);
+    free_hyper_log_log(ws->hll);
+    free(ws);
+}
+
+
+/* The string is hashed once and the hashes are shared by all parts. */
+void word_sketch_add(word_sketch *ws, char *key)
+{
+    unsigned long h1;
+    unsigned long h2;
+    unsigned long count;
+
+    h1 = sketch_hash(key, 0);
+    h2 = sketch_hash(key, 1) | 1;
+
+    count = cms_add_hashed(ws->cms, h1, h2);
+    heavy_hitters_update_hashed(ws->top, key, h1, count);
+    hll_add_hashed(ws->hll, h1);
+    ws->total++;
+}
+
+
+long word_sketch_memory(word_sketch *ws)
+{
+    long bytes;
+
+    bytes = sizeof(word_sketch);
+    bytes += sizeof(count_min_sketch)
+        + (long) ws->cms->width * ws->cms->depth * sizeof(unsigned long);
+    bytes += sizeof(heavy_hitters)
+        + ws->top->capacity * (sizeof(heavy_hitter) + sizeof(int))
+        + (ws->top->index_mask + 1) * sizeof(int);
+    bytes += sizeof(hyper_log_log) + ws->hll->nregisters;
+    return bytes;
+}
+
+
+void print_word_sketch(word_sketch *ws)
+{
+    print_heavy_hitters(ws->top);
+}
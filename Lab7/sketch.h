@@ -0,0 +1,185 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: sketch.h
+ *     Fixed-memory approximate word counting: a Count-Min Sketch for
+ *     frequencies, a heavy-hitters heap for the top K words and a
+ *     HyperLogLog counter for the number of distinct words.
+ *
+ */
+
+#ifndef SKETCH_H
+#define SKETCH_H
+
+/* Longest key (including the zero byte) kept by the heavy-hitters heap. */
+#define SKETCH_MAX_KEY 100
+
+/* Default number of rows in the Count-Min Sketch. */
+#define SKETCH_DEPTH 4
+
+/* Default HyperLogLog precision: 2^12 one-byte registers. */
+#define SKETCH_PRECISION 12
+
+/*
+ * Widest row of the Count-Min Sketch.  The hashes have 32 bits and the
+ * width is an int, so wider rows would gain nothing or overflow; this
+ * also bounds the memory budget, in kilobytes, that can be asked for.
+ */
+#define SKETCH_MAX_WIDTH (1L << 24)
+#define SKETCH_MAX_KB \
+    (SKETCH_MAX_WIDTH * SKETCH_DEPTH * (long) sizeof(unsigned long) / 1024)
+
+
+/*
+ * Data structure definitions.
+ */
+
+/*
+ * Count-Min Sketch: 'depth' rows of 'width' counters.  Each key maps to
+ * one counter per row and its estimate is the smallest of them, which is
+ * never below the true count.
+ */
+
+typedef struct
+{
+    int width;              /* counters per row (a power of two) */
+    int depth;              /* number of rows */
+    unsigned long *count;   /* depth * width counters */
+} count_min_sketch;
+
+/*
+ * One word tracked by the heavy-hitters heap.
+ */
+
+typedef struct
+{
+    char key[SKETCH_MAX_KEY];
+    unsigned long hash;     /* hash of 'key', used by the index */
+    unsigned long count;    /* estimated count of 'key' */
+    int heap_pos;           /* position of this entry in 'heap' */
+} heavy_hitter;
+
+/*
+ * Heavy hitters: the 'capacity' words with the largest estimated counts.
+ * 'heap' is a min-heap of entry numbers ordered by count, and 'index' is
+ * an open-addressing table from key to entry number (-1 when empty).
+ */
+
+typedef struct
+{
+    int capacity;
+    int size;
+    heavy_hitter *entry;
+    int *heap;
+    int *index;
+    int index_mask;         /* index size - 1 (a power of two) */
+} heavy_hitters;
+
+/*
+ * HyperLogLog distinct counter with 2^precision registers.
+ */
+
+typedef struct
+{
+    int precision;
+    int nregisters;
+    unsigned char *reg;
+} hyper_log_log;
+
+/*
+ * The complete approximate word counter.
+ */
+
+typedef struct
+{
+    count_min_sketch *cms;
+    heavy_hitters *top;
+    hyper_log_log *hll;
+    unsigned long total;    /* number of words added */
+} word_sketch;
+
+
+/*
+ * Function declarations.
+ */
+
+/*** Hash function. ***/
+
+/* 32-bit string hash; different seeds give independent hash functions. */
+unsigned long sketch_hash(char *s, unsigned long seed);
+
+
+/*** Count-Min Sketch. ***/
+
+/* 'width' is rounded down to a power of two. */
+count_min_sketch *create_count_min_sketch(int width, int depth);
+
+void free_count_min_sketch(count_min_sketch *cms);
+
+/*
+ * Add one occurrence of 'key' and return its new estimated count.
+ * Conservative update is used: only the counters that hold the current
+ * minimum are incremented, which keeps overestimates small.
+ */
+unsigned long cms_add(count_min_sketch *cms, char *key);
+
+/* Return the estimated count of 'key'.  Never below the true count. */
+unsigned long cms_estimate(count_min_sketch *cms, char *key);
+
+
+/*** Heavy hitters. ***/
+
+heavy_hitters *create_heavy_hitters(int capacity);
+
+void free_heavy_hitters(heavy_hitters *hh);
+
+/*
+ * Record that 'key' now has estimated count 'count'.  The key is kept if
+ * it is already tracked or if its count beats the smallest one kept.
+ */
+void heavy_hitters_update(heavy_hitters *hh, char *key, unsigned long count);
+
+/*
+ * Store the tracked entries into 'out' in decreasing order of count (ties
+ * in increasing order of key) and return how many were stored.  'out'
+ * must have room for 'capacity' pointers.
+ */
+int heavy_hitters_sorted(heavy_hitters *hh, heavy_hitter **out);
+
+/* Print the tracked entries, in the order above, as key/count pairs. */
+void print_heavy_hitters(heavy_hitters *hh);
+
+
+/*** HyperLogLog. ***/
+
+/* 'precision' must be between 4 and 16. */
+hyper_log_log *create_hyper_log_log(int precision);
+
+void free_hyper_log_log(hyper_log_log *hll);
+
+void hll_add(hyper_log_log *hll, char *key);
+
+/* Return the estimated number of distinct keys added. */
+double hll_estimate(hyper_log_log *hll);
+
+
+/*** Approximate word counter. ***/
+
+/*
+ * Create a word counter whose Count-Min Sketch uses about 'cms_bytes'
+ * bytes, but rows at most SKETCH_MAX_WIDTH wide, which tracks the top
+ * 'k' words.  The memory used never grows after creation.
+ */
+word_sketch *create_word_sketch(long cms_bytes, int k);
+
+void free_word_sketch(word_sketch *ws);
+
+void word_sketch_add(word_sketch *ws, char *key);
+
+/* Return the total number of bytes used by the word counter. */
+long word_sketch_memory(word_sketch *ws);
+
+/* Print the top words and their estimated counts as key/value pairs. */
+void print_word_sketch(word_sketch *ws);
+
+#endif  /* SKETCH_H */
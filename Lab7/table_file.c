@@ -0,0 +1,304 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: table_file.c
+ *     Saving counted hash tables to disk and mapping them back in.
+ *
+ */
+
+/* Needed for mmap, open and fstat under -ansi. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "table_file.h"
+#include "sketch.h"
+#include "memcheck.h"
+
+
+/* Hash used to place keys in the slot array of a table file. */
+static unsigned int file_hash(char *key)
+{
+    return (unsigned int) sketch_hash(key, 0);
+}
+
+
+/*
+ * Write 'n' bytes to 'fp'.  Return 0 on success and -1 on failure.
+ */
+static int write_bytes(FILE *fp, void *data, size_t n)
+{
+    return (n == 0 || fwrite(data, 1, n, fp) == n) ? 0 : -1;
+}
+
+
+int save_hash_table(hash_table *ht, char *filename)
+{
+    table_header header;
+    table_slot *slot;
+    int *value;
+    char *arena;
+    char *tmpname;
+    node *curr;
+    unsigned long arena_size;
+    unsigned int nslots;
+    unsigned int pos;
+    unsigned int mask;
+    unsigned int nentries;
+    size_t len;
+    FILE *fp;
+    int status;
+    int i;
+
+    /* Size the slot array so it is at most half full. */
+    nentries = (unsigned int) count_entries(ht);
+    for (nslots = 8; nslots < 2 * nentries; nslots *= 2)
+    {
+        ;
+    }
+    mask = nslots - 1;
+
+    arena_size = 0;
+    for (i = 0; i < NSLOTS; i++)
+    {
+        for (curr = ht->slot[i]; curr != NULL; curr = curr->next)
+        {
+            arena_size += strlen(curr->key) + 1;
+        }
+    }
+
+    if (arena_size + nslots * (sizeof(table_slot) + sizeof(int))
+        + sizeof(table_header) >= TABLE_EMPTY_SLOT)
+    {
+        fprintf(stderr, "Error! Table is too large for a table file.\n");
+        return -1;
+    }
+
+    slot = (table_slot *) malloc(nslots * sizeof(table_slot));
+    value = (int *) calloc(nslots, sizeof(int));
+    arena = (char *) malloc(arena_size + 1);
+    tmpname = (char *) malloc(strlen(filename) + 5);
+    /* Checking memorry allocation did not fail. */
+    if (slot == NULL || value == NULL || arena == NULL || tmpname == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+
+    for (pos = 0; pos < nslots; pos++)
+    {
+        slot[pos].hash = 0;
+        slot[pos].key_offset = TABLE_EMPTY_SLOT;
+    }
+
+    /* Copy each key into the arena and place it by linear probing. */
+    arena_size = 0;
+    for (i = 0; i < NSLOTS; i++)
+    {
+        for (curr = ht->slot[i]; curr != NULL; curr = curr->next)
+        {
+            unsigned int h = file_hash(curr->key);
+
+            pos = h & mask;
+            while (slot[pos].key_offset != TABLE_EMPTY_SLOT)
+            {
+                pos = (pos + 1) & mask;
+            }
+
+            len = strlen(curr->key) + 1;
+            memcpy(arena + arena_size, curr->key, len);
+            slot[pos].hash = h;
+            slot[pos].key_offset = (unsigned int) arena_size;
+            value[pos] = curr->value;
+            arena_size += len;
+        }
+    }
+
+    header.magic = TABLE_FILE_MAGIC;
+    header.version = TABLE_FILE_VERSION;
+    header.nslots = nslots;
+    header.nentries = nentries;
+    header.slots_offset = sizeof(table_header);
+    header.values_offset = header.slots_offset
+        + nslots * sizeof(table_slot);
+    header.arena_offset = header.values_offset + nslots * sizeof(int);
+    header.arena_size = (unsigned int) arena_size;
+
+    /* Write to a temporary file first, then rename it into place. */
+    strcpy(tmpname, filename);
+    strcat(tmpname, ".tmp");
+
+    status = -1;
+    fp = fopen(tmpname, "wb");
+    if (fp != NULL)
+    {
+        status = write_bytes(fp, &header, sizeof(header));
+        if (status == 0)
+        {
+            status = write_bytes(fp, slot, nslots * sizeof(table_slot));
+        }
+        if (status == 0)
+        {
+            status = write_bytes(fp, value, nslots * sizeof(int));
+        }
+        if (status == 0)
+        {
+            status = write_bytes(fp, arena, arena_size);
+        }
+        if (fclose(fp) != 0)
+        {
+            status = -1;
+        }
+        if (status == 0 && rename(tmpname, filename) != 0)
+        {
+            status = -1;
+        }
+        if (status != 0)
+        {
+            remove(tmpname);
+        }
+    }
+
+    free(slot);
+    free(value);
+    free(arena);
+    free(tmpname);
+
+    return status;
+}
+
+
+mapped_table *open_mapped_table(char *filename)
+{
+    mapped_table *mt;
+    table_header *h;
+    struct stat st;
+    void *base;
+    size_t size;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(table_header))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    size = (size_t) st.st_size;
+    base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  /* The mapping stays valid after the file is closed. */
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    /*
+     * Check the header so that a bad file can never make a lookup read
+     * outside the mapping.
+     */
+    h = (table_header *) base;
+    if (h->magic != TABLE_FILE_MAGIC
+        || h->version != TABLE_FILE_VERSION
+        || h->nslots == 0 || (h->nslots & (h->nslots - 1)) != 0
+        || h->nentries > h->nslots
+        || h->slots_offset != sizeof(table_header)
+        || h->values_offset != h->slots_offset
+                               + h->nslots * sizeof(table_slot)
+        || h->arena_offset != h->values_offset + h->nslots * sizeof(int)
+        || (size_t) h->arena_offset + h->arena_size != size
+        || (h->arena_size > 0 && ((char *) base)[size - 1] != '\0'))
+    {
+        munmap(base, size);
+        return NULL;
+    }
+
+    mt = (mapped_table *) malloc(sizeof(mapped_table));
+    /* Checking memorry allocation did not fail. */
+    if (mt == NULL)
+    {
+        fprintf(stderr, "Error! Memory allocation failed!\n");
+        exit(1);
+    }
+
+    mt->base = base;
+    mt->size = size;
+    mt->header = h;
+    mt->slot = (table_slot *) ((char *) base + h->slots_offset);
+    mt->value = (int *) ((char *) base + h->values_offset);
+    mt->arena = (char *) base + h->arena_offset;
+
+    return mt;
+}
+
+
+void close_mapped_table(mapped_table *mt)
+{
+    munmap(mt->base, mt->size);
+    free(mt);
+}
+
+
+int mapped_get_value(mapped_table *mt, char *key)
+{
+    unsigned int h;
+    unsigned int pos;
+    unsigned int mask;
+    table_slot *s;
+
+    h = file_hash(key);
+    mask = mt->header->nslots - 1;
+
+    /* Probe at most 'nslots' slots, even if the file has no empty one. */
+    for (pos = 0; pos <= mask; pos++)
+    {
+        s = &mt->slot[(h + pos) & mask];
+        if (s->key_offset == TABLE_EMPTY_SLOT)
+        {
+            return 0;
+        }
+        if (s->hash == h && s->key_offset < mt->header->arena_size
+            && strcmp(mt->arena + s->key_offset, key) == 0)
+        {
+            return mt->value[(h + pos) & mask];
+        }
+    }
+    return 0;
+}
+
+
+void merge_mapped_table(hash_table *ht, mapped_table *mt)
+{
+    unsigned int pos;
+    char *key;
+    char *new_key;
+
+    for (pos = 0; pos < mt->header->nslots; pos++)
+    {
+        if (mt->slot[pos].key_offset >= mt->header->arena_size)
+        {
+            continue;
+        }
+        key = mt->arena + mt->slot[pos].key_offset;
+
+        /* The hash table owns its keys, so it needs a copy. */
+        new_key = (char *) malloc(strlen(key) + 1);
+        /* Checking memorry allocation did not fail. */
+        if (new_key == NULL)
+        {
+            fprintf(stderr, "Error! Memory allocation failed!\n");
+            exit(1);
+        }
+        strcpy(new_key, key);
+
+        set_value(ht, new_key, get_value(ht, key) + mt->value[pos]);
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: table_file.h
+ *     On-disk format for a counted hash table, and functions to save a
+ *     table and to map a saved table back into memory.
+ *
+ *     A table file holds, in order:
+ *
+ *         table_header                   (fixed size)
+ *         table_slot[nslots]             (open-addressing hash array)
+ *         int[nslots]                    (values, parallel to the slots)
+ *         char[arena_size]               (zero-terminated keys)
+ *
+ *     Keys are referred to by their offset into the key arena, never by
+ *     address, so the file can be mapped anywhere and used in place
+ *     without parsing or allocating anything per key.  All fields are in
+ *     the byte order of the machine that wrote the file.
+ *
+ */
+
+#ifndef TABLE_FILE_H
+#define TABLE_FILE_H
+
+#include <stddef.h>
+#include "hash_table.h"
+
+/* "HTBL" read as a little-endian 32-bit number. */
+#define TABLE_FILE_MAGIC    0x4c425448U
+#define TABLE_FILE_VERSION  1U
+
+/* Key offset stored in a slot that holds no key. */
+#define TABLE_EMPTY_SLOT    0xffffffffU
+
+
+/*
+ * Data structure definitions.  'unsigned int' is used for every field
+ * because it is 32 bits wide on all the machines we build for.
+ */
+
+typedef struct
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int nslots;        /* a power of two */
+    unsigned int nentries;
+    unsigned int slots_offset;  /* file offsets of the three arrays */
+    unsigned int values_offset;
+    unsigned int arena_offset;
+    unsigned int arena_size;
+} table_header;
+
+typedef struct
+{
+    unsigned int hash;          /* full hash of the key */
+    unsigned int key_offset;    /* offset into the arena, or empty */
+} table_slot;
+
+/*
+ * A table file mapped into memory.  The pointers point into the mapping.
+ */
+
+typedef struct
+{
+    void *base;
+    size_t size;
+    table_header *header;
+    table_slot *slot;
+    int *value;
+    char *arena;
+} mapped_table;
+
+
+/*
+ * Function declarations.
+ */
+
+/*
+ * Write the contents of 'ht' to 'filename'.  The file is written under a
+ * temporary name and renamed into place, so an existing file is never
+ * left half-written.  Return 0 on success and -1 on failure.
+ */
+int save_hash_table(hash_table *ht, char *filename);
+
+/*
+ * Map a table file into memory and check that it is well formed.
+ * Return NULL if the file cannot be opened or is not a table file.
+ */
+mapped_table *open_mapped_table(char *filename);
+
+void close_mapped_table(mapped_table *mt);
+
+/*
+ * Look for a key in a mapped table.  Return 0 if not found.
+ * If it is found return the associated value.
+ */
+int mapped_get_value(mapped_table *mt, char *key);
+
+/* Add every count of a mapped table to the counts in 'ht'. */
+void merge_mapped_table(hash_table *ht, mapped_table *mt);
+
+#endif  /* TABLE_FILE_H */
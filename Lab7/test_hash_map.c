@@ -0,0 +1,221 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: test_hash_map.c
+ *     Test of the generic maps of hash_map.h.  A word map numbers the
+ *     words of a file in order of first appearance, and a map from those
+ *     numbers, made with HASH_MAP_DEFINE, counts the words by number; its
+ *     counts must match those of a second word map counting the words
+ *     themselves.  A map from random numbers is then checked against a
+ *     sorted array of the same numbers.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hash_map.h"
+#include "word_map.h"
+#include "memcheck.h"
+
+/* Longest line read from the file. */
+#define MAX_WORD_LENGTH 100
+
+/* Random keys inserted, drawn from [0, KEY_RANGE). */
+#define NKEYS 100000
+#define KEY_RANGE 50000
+
+HASH_MAP_DECLARE(count_map, long, long)
+HASH_MAP_DEFINE(count_map, long, long, HASH_MAP_INT_HASH, HASH_MAP_EQUAL)
+
+
+void fail(char *what);
+unsigned long next_random(void);
+int compare_longs(const void *a, const void *b);
+void test_word_counts(FILE *fp);
+void test_random_keys(void);
+
+
+unsigned long random_state = 2463534242UL;
+
+
+void fail(char *what)
+{
+    fprintf(stderr, "Hash map test failed: %s!\n", what);
+    exit(1);
+}
+
+
+/* 32-bit xorshift random number generator. */
+unsigned long next_random(void)
+{
+    random_state ^= (random_state << 13) & 0xffffffffUL;
+    random_state ^= random_state >> 17;
+    random_state ^= (random_state << 5) & 0xffffffffUL;
+    return random_state;
+}
+
+
+/* Comparison function for `qsort`: increasing order. */
+int compare_longs(const void *a, const void *b)
+{
+    long x = *(const long *) a;
+    long y = *(const long *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+/*
+ * Count the words of 'fp' by number and by word, and check that every
+ * word has the same count both ways.
+ */
+void test_word_counts(FILE *fp)
+{
+    char line[MAX_WORD_LENGTH];
+    char word[MAX_WORD_LENGTH];
+    word_map *numbers;
+    word_map *counts;
+    count_map *by_number;
+    long *number;
+    long *count;
+    size_t i;
+
+    numbers = word_map_create();
+    counts = word_map_create();
+    by_number = count_map_create();
+
+    while (fgets(line, MAX_WORD_LENGTH, fp) != NULL)
+    {
+        if (sscanf(line, "%s", word) != 1)
+        {
+            continue;
+        }
+
+        /* New words get the next number, from 1. */
+        number = word_map_insert(numbers, word);
+        if (*number == 0)
+        {
+            *number = (long) numbers->size;
+        }
+
+        (*count_map_insert(by_number, *number))++;
+        (*word_map_insert(counts, word))++;
+    }
+
+    if (by_number->size != counts->size || counts->size == 0)
+    {
+        fail("the maps hold different numbers of words");
+    }
+
+    for (i = word_map_next(counts, 0); i < counts->nslots;
+         i = word_map_next(counts, i + 1))
+    {
+        number = word_map_find(numbers,
+                               STRING_MAP_KEY(&counts->slot[i]));
+        count = count_map_find(by_number, *number);
+        if (count == NULL || *count != counts->slot[i].value)
+        {
+            fail("a word was counted differently by number");
+        }
+    }
+
+    word_map_free(numbers);
+    word_map_free(counts);
+    count_map_free(by_number);
+}
+
+
+/*
+ * Insert random keys, many of them more than once, and check the count
+ * of each, the keys that are absent, and a walk over all the slots
+ * against the keys sorted.
+ */
+void test_random_keys(void)
+{
+    static long keys[NKEYS];
+    count_map *m;
+    long *count;
+    long total;
+    long distinct;
+    long i;
+    long j;
+    size_t s;
+
+    m = count_map_create();
+    for (i = 0; i < NKEYS; i++)
+    {
+        keys[i] = (long) (next_random() % KEY_RANGE);
+        (*count_map_insert(m, keys[i]))++;
+    }
+    qsort(keys, NKEYS, sizeof(long), compare_longs);
+
+    distinct = 0;
+    for (i = 0; i < NKEYS; i = j)
+    {
+        for (j = i; j < NKEYS && keys[j] == keys[i]; j++)
+        {
+            ;
+        }
+        count = count_map_find(m, keys[i]);
+        if (count == NULL || *count != j - i)
+        {
+            fail("a random key has the wrong count");
+        }
+        distinct++;
+    }
+    if ((long) m->size != distinct)
+    {
+        fail("the map holds the wrong number of keys");
+    }
+
+    for (i = KEY_RANGE; i < KEY_RANGE + 1000; i++)
+    {
+        if (count_map_find(m, i) != NULL || count_map_find(m, -i) != NULL)
+        {
+            fail("a key that was never inserted was found");
+        }
+    }
+
+    total = 0;
+    distinct = 0;
+    for (s = count_map_next(m, 0); s < m->nslots;
+         s = count_map_next(m, s + 1))
+    {
+        total += m->slot[s].value;
+        distinct++;
+    }
+    if (total != NKEYS || (size_t) distinct != m->size)
+    {
+        fail("walking the slots missed some keys");
+    }
+
+    count_map_free(m);
+}
+
+
+int main(int argc, char *argv[])
+{
+    FILE *fp;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s filename\n", argv[0]);
+        exit(1);
+    }
+
+    fp = fopen(argv[1], "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Error! Cannot open %s!\n", argv[1]);
+        exit(1);
+    }
+    test_word_counts(fp);
+    fclose(fp);
+
+    test_random_keys();
+
+    print_memory_leaks();
+    printf("Hash map test succeeded!\n");
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: test_memcheck.c
+ *     Test of the memory checker from many threads.  Rounds of threads
+ *     each allocate many blocks, resize them all and free half of them,
+ *     and exit; other threads then free the other half.  The resizing
+ *     threads free old blocks whose addresses the others may be given at
+ *     once, so the records of those addresses must not get mixed up.  Afterwards no memory may be live,
+ *     and memcheck's own records may not have grown after the first
+ *     round: the nodes each exiting thread kept for itself must have been
+ *     given back for the threads after it.
+ *
+ */
+
+/* Needed for pthreads under -ansi. */
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "memcheck.h"
+
+#define THREADS 8
+#define ROUNDS 200
+#define BLOCKS 4000
+
+
+/* A thread of a round, and the blocks it allocated. */
+
+typedef struct
+{
+    void *blocks[BLOCKS];
+    pthread_t thread;
+} test_thread;
+
+
+void *thread_main(void *arg);
+void *free_half(void *arg);
+void run_round(test_thread *threads);
+void fail(char *what);
+
+
+void fail(char *what)
+{
+    fprintf(stderr, "Memcheck thread test failed: %s!\n", what);
+    exit(1);
+}
+
+
+/* Allocate the blocks, resize them, and free the first half of them. */
+void *thread_main(void *arg)
+{
+    test_thread *t = (test_thread *)arg;
+    int i;
+
+    for (i = 0; i < BLOCKS; i++)
+    {
+        t->blocks[i] = malloc(16 + i % 64);
+        if (t->blocks[i] == NULL)
+        {
+            fail("malloc returned NULL");
+        }
+    }
+    for (i = 0; i < BLOCKS; i++)
+    {
+        t->blocks[i] = realloc(t->blocks[i], 16 + (i * 37) % 512);
+        if (t->blocks[i] == NULL)
+        {
+            fail("realloc returned NULL");
+        }
+    }
+    return free_half(t);
+}
+
+
+/* Free the first half of the blocks. */
+void *free_half(void *arg)
+{
+    test_thread *t = (test_thread *)arg;
+    int i;
+
+    for (i = 0; i < BLOCKS / 2; i++)
+    {
+        free(t->blocks[i]);
+    }
+    return NULL;
+}
+
+
+/*
+ * Run one round of threads, then free the second halves of their blocks
+ * from yet more threads, so that nodes are freed on other threads than
+ * those that took them.
+ */
+void run_round(test_thread *threads)
+{
+    int i;
+    int j;
+
+    for (i = 0; i < THREADS; i++)
+    {
+        if (pthread_create(&threads[i].thread, NULL, thread_main,
+                           &threads[i]) != 0)
+        {
+            fail("cannot start a thread");
+        }
+    }
+    for (i = 0; i < THREADS; i++)
+    {
+        pthread_join(threads[i].thread, NULL);
+    }
+
+    for (i = 0; i < THREADS; i++)
+    {
+        for (j = 0; j < BLOCKS / 2; j++)
+        {
+            threads[i].blocks[j] = threads[i].blocks[BLOCKS / 2 + j];
+        }
+    }
+    for (i = 0; i < THREADS; i++)
+    {
+        if (pthread_create(&threads[i].thread, NULL, free_half,
+                           &threads[i]) != 0)
+        {
+            fail("cannot start a thread");
+        }
+    }
+    for (i = 0; i < THREADS; i++)
+    {
+        pthread_join(threads[i].thread, NULL);
+    }
+}
+
+
+int main(void)
+{
+    static test_thread threads[THREADS];
+    memcheck_stats first;
+    memcheck_stats last;
+    int r;
+
+    run_round(threads);
+    get_memcheck_stats(&first);
+
+    for (r = 1; r < ROUNDS; r++)
+    {
+        run_round(threads);
+    }
+    get_memcheck_stats(&last);
+
+    if (last.live_bytes != 0 || last.live_blocks != 0)
+    {
+        fail("memory is still live");
+    }
+    /* Every block was allocated once and resized once. */
+    if (last.allocs != 2UL * ROUNDS * THREADS * BLOCKS)
+    {
+        fail("allocations were lost");
+    }
+    if (last.node_bytes > 2 * first.node_bytes)
+    {
+        fprintf(stderr, "%lu bytes of records after one round, %lu after "
+                "%d.\n", first.node_bytes, last.node_bytes, ROUNDS);
+        fail("exited threads kept their records");
+    }
+
+    print_memory_leaks();
+    printf("Memcheck thread test succeeded!\n");
+    return 0;
+}
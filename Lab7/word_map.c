@@ -0,0 +1,65 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: word_map.c
+ *     Instantiation of the word count map.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "word_map.h"
+#include "memcheck.h"
+
+
+STRING_MAP_DEFINE(word_map, long)
+
+
+/* Comparison function for `qsort`: increasing order of key. */
+static int compare_slot_keys(const void *a, const void *b)
+{
+    word_map_slot *x = *(word_map_slot * const *) a;
+    word_map_slot *y = *(word_map_slot * const *) b;
+
+    return strcmp(STRING_MAP_KEY(x), STRING_MAP_KEY(y));
+}
+
+
+/* Print out the contents of the map as key/value pairs. */
+void print_word_map(word_map *m, int sorted)
+{
+    word_map_slot **entries;
+    size_t i;
+    size_t n;
+
+    if (m->size == 0)
+    {
+        return;
+    }
+
+    entries = (word_map_slot **) malloc(m->size * sizeof(word_map_slot *));
+    /* Checking memorry allocation did not fail. */
+    if (entries == NULL)
+    {
+        hash_map_out_of_memory();
+    }
+
+    n = 0;
+    for (i = word_map_next(m, 0); i < m->nslots; i = word_map_next(m, i + 1))
+    {
+        entries[n++] = &m->slot[i];
+    }
+
+    if (sorted)
+    {
+        qsort(entries, n, sizeof(word_map_slot *), compare_slot_keys);
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        printf("%s %ld\n", STRING_MAP_KEY(entries[i]), entries[i]->value);
+    }
+
+    free(entries);
+}
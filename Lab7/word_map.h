@@ -0,0 +1,26 @@
+/*
+ * CS 11, C Track, lab 7
+ *
+ * FILE: word_map.h
+ *     A string map from words to counts, generated from hash_map.h.
+ *
+ */
+
+#ifndef WORD_MAP_H
+#define WORD_MAP_H
+
+#include "hash_map.h"
+
+/*
+ * Counts are kept in a 'long', which is 64 bits wide on the LP64 systems
+ * we build for, so they cannot overflow the way an 'int' could.
+ */
+STRING_MAP_DECLARE(word_map, long)
+
+/*
+ * Print out the contents of the map as key/value pairs, in increasing
+ * order of key if 'sorted' is set and in slot order otherwise.
+ */
+void print_word_map(word_map *m, int sorted);
+
+#endif  /* WORD_MAP_H */